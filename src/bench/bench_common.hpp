@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <optional>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../lumina/lumina.hpp"
+
+// shared setup of benchmark executables
+// mirrors the scene configured in main.cpp
+namespace bench {
+
+constexpr const char* DEFAULT_SCENE = "../asset/mori_knob/mori_knob.obj";
+
+inline lumina::mesh load_mori_knob(const char* path) {
+    auto mesh = [path] {
+        // .lmesh -> mapped binary mesh
+        if(std::filesystem::path(path).extension() == ".lmesh") {
+            auto binary = lumina::load_mesh_binary(path);
+            if(!binary) {
+                std::exit(EXIT_FAILURE);
+            }
+            return std::move(*binary);
+        }
+        return lumina::mesh(lumina::load_obj_parallel(path));
+    }();
+    mesh.add_material("BackGroundMat", lumina::material{.albedo = {0.8f}, .emission = {0.0f}, .roughness = 0.2f, .refractive_index = 0.0f});
+    mesh.add_material("InnerMat", lumina::material{.albedo = {0.8f, 0.0f, 0.0f}, .emission = {0.0f}, .roughness = 0.0f, .refractive_index = 0.0f});
+    mesh.add_material("LTELogo", lumina::material{.albedo = {0.0f, 0.8f, 0.0f}, .emission = {0.0f, 0.8f, 0.0f}, .roughness = 1.0f, .refractive_index = 0.0f, .type = lumina::material_type::diffuse});
+    mesh.add_material("Material", lumina::material{.albedo = {1.0f}, .emission = {1.0f}, .roughness = 1.0f, .refractive_index = 0.0f, .type = lumina::material_type::diffuse});
+    mesh.add_material("OuterMat", lumina::material{.albedo = {1.0f}, .emission = {0.0f}, .roughness = 0.0f, .refractive_index = 0.0f});
+    return mesh;
+}
+
+inline lumina::camera mori_knob_camera(lumina::u32 width, lumina::u32 height) {
+    return lumina::camera(
+        {1.0f, 1.0f, -1.0f},
+        {0.0f, 0.7f, -0.5f},
+        {0.0f, 1.0f, 0.0f},
+        90.0f, width, height
+    );
+}
+
+inline lumina::f64 seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<lumina::f64>(std::chrono::steady_clock::now() - start).count();
+}
+
+// runs f(thread index, item) for items [0, count) on all hardware threads
+template<class F>
+void parallel_for(lumina::u32 count, F&& f) {
+    auto thread_count = std::max<lumina::u32>(1, std::thread::hardware_concurrency());
+    std::atomic<lumina::u32> next{};
+    std::vector<std::thread> threads{};
+    for(lumina::u32 t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            for(auto i = next++; i < count; i = next++) {
+                f(t, i);
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+}
+
+// hardware cache misses of this process (including threads started while counting)
+// only on linux with perf events available, count() is std::nullopt otherwise
+class cache_miss_counter {
+    int fd_ = -1;
+
+public:
+    cache_miss_counter() {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if(fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    ~cache_miss_counter() {
+#if defined(__linux__)
+        if(fd_ >= 0) {
+            close(fd_);
+        }
+#endif
+    }
+
+    cache_miss_counter(const cache_miss_counter&) = delete;
+    cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+
+    std::optional<lumina::u64> count() const {
+#if defined(__linux__)
+        lumina::u64 value{};
+        if(fd_ >= 0 && read(fd_, &value, sizeof(value)) == sizeof(value)) {
+            return value;
+        }
+#endif
+        return std::nullopt;
+    }
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "bench_common.hpp"
+
+// acceleration structure comparison: binary bvh, 4-wide bvh with full precision nodes (wide_bvh) and quantized nodes (qbvh)
+// both 4-wide variants share topology and traversal, so their difference is the node format only
+// every accelerator is built from median, sah and sbvh (spatial splits) binary bvhs
+// and measured in build order (bfs) and after depth first reordering with polygons in leaf order (dfs)
+// usage: lumina_bvh_bench [obj path] [spp] [sbvh alpha]
+// output (CSV): builder,accelerator,layout,nodes,node_bytes,references,duplicated_references,sah_cost,build_seconds,mean_child_distance_bytes,primary_cache_misses,primary_mrays_per_sec,path_mrays_per_sec,mismatches
+// references: leaves of the binary bvh, duplicated_references: references beyond one per polygon (spatial splits)
+// sah_cost: expected traversal + intersection cost of the binary bvh, compare builders by it
+// mean_child_distance_bytes: mean |child - parent| in bytes over internal children, smaller is more local
+// primary_cache_misses: hardware cache misses while tracing primary rays (n/a without perf events)
+// mismatches: primary rays whose closest hit differs from the first row
+
+constexpr lumina::u32 IMAGE_WIDTH  = 160;
+constexpr lumina::u32 IMAGE_HEIGHT = 90;
+
+using hit_type = std::optional<std::pair<lumina::u32, lumina::f32>>;
+
+void add_child_distances(const lumina::bvh_node& node, lumina::s64 parent, lumina::f64& sum, lumina::u64& count) {
+    for(auto child : {node.left_index, node.right_index}) {
+        if(child > 0) {
+            sum += std::abs(child - parent);
+            ++count;
+        }
+    }
+}
+
+template<class Node>
+void add_child_distances(const Node& node, lumina::s64 parent, lumina::f64& sum, lumina::u64& count) {
+    for(auto child : node.children) {
+        if(child > 0) {
+            sum += std::abs(child - parent);
+            ++count;
+        }
+    }
+}
+
+template<class Node>
+lumina::f64 mean_child_distance_bytes(std::span<const Node> nodes) {
+    lumina::f64 sum{};
+    lumina::u64 count{};
+    for(size_t i = 0; i < nodes.size(); ++i) {
+        add_child_distances(nodes[i], static_cast<lumina::s64>(i), sum, count);
+    }
+    return count > 0 ? sum / lumina::f64(count) * sizeof(Node) : 0.0;
+}
+
+template<class Accelerator>
+void measure(const char* builder, const char* name, const char* layout, const Accelerator& accel, const lumina::bvh& bvh, lumina::f64 build_seconds, const lumina::mesh& mesh, const lumina::camera& cam, lumina::u32 spp, std::vector<hit_type>& reference) {
+    // primary rays
+    std::vector<hit_type> hits(IMAGE_WIDTH * IMAGE_HEIGHT * spp);
+    bench::cache_miss_counter counter{};
+    auto start = std::chrono::steady_clock::now();
+    bench::parallel_for(IMAGE_HEIGHT, [&](lumina::u32, lumina::u32 y) {
+        lumina::sobol_sampler sampler(1);
+        for(lumina::u32 s = 0; s < spp; ++s) {
+            for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+                sampler.start_pixel_sample(x, y, s);
+                hits[(s * IMAGE_HEIGHT + y) * IMAGE_WIDTH + x] = accel.trace(mesh.vertices, mesh.vertex_indices, cam.generate_ray(x, y, sampler), lumina::F32_MAX);
+            }
+        }
+    });
+    auto primary_seconds = bench::seconds_since(start);
+    auto cache_misses = counter.count();
+
+    // full paths, every traced ray counts
+    std::atomic<lumina::u64> rays{};
+    start = std::chrono::steady_clock::now();
+    bench::parallel_for(IMAGE_HEIGHT, [&](lumina::u32, lumina::u32 y) {
+        lumina::sobol_sampler sampler(1);
+        lumina::u64 local_rays{};
+        for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+            for(lumina::u32 s = 0; s < spp; ++s) {
+                sampler.start_pixel_sample(x, y, s);
+                local_rays += lumina::trace_ray(cam.generate_ray(x, y, sampler), accel, mesh, sampler).length;
+            }
+        }
+        rays += local_rays;
+    });
+    auto path_seconds = bench::seconds_since(start);
+
+    if(reference.empty()) {
+        reference = hits;
+    }
+    lumina::u64 mismatches{};
+    for(size_t i = 0; i < hits.size(); ++i) {
+        const auto& a = hits[i];
+        const auto& b = reference[i];
+        auto same = (!a && !b) || (a && b && (a->first == b->first || std::abs(a->second - b->second) <= 1.0e-4f * b->second));
+        mismatches += same ? 0 : 1;
+    }
+
+    auto nodes = accel.nodes();
+    auto misses = cache_misses ? std::to_string(*cache_misses) : std::string("n/a");
+    auto duplicated = bvh.references() - mesh.vertex_indices.size();
+    std::cout << std::format("{},{},{},{},{},{},{},{:.2f},{:.4f},{:.1f},{},{:.3f},{:.3f},{}\n", builder, name, layout, nodes.size(), nodes.size_bytes(), bvh.references(), duplicated, bvh.sah_cost(), build_seconds, mean_child_distance_bytes(nodes), misses, lumina::f64(hits.size()) / primary_seconds / 1.0e6, lumina::f64(rays) / path_seconds / 1.0e6, mismatches) << std::flush;
+}
+
+// bfs and dfs layouts of every accelerator on a bvh of one builder
+void measure_builder(const char* builder, const lumina::bvh_options& options, lumina::mesh& mesh, const lumina::camera& cam, lumina::u32 spp, std::vector<hit_type>& reference) {
+    auto start = std::chrono::steady_clock::now();
+    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices, options);
+    auto bvh_seconds = bench::seconds_since(start);
+
+    // collapse time only (built from bvh)
+    start = std::chrono::steady_clock::now();
+    lumina::wide_bvh<lumina::wide_bvh_node> wide(bvh);
+    auto wide_seconds = bench::seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    lumina::qbvh qbvh(bvh);
+    auto qbvh_seconds = bench::seconds_since(start);
+
+    measure(builder, "bvh", "bfs", bvh, bvh, bvh_seconds, mesh, cam, spp, reference);
+    measure(builder, "wide_bvh", "bfs", wide, bvh, wide_seconds, mesh, cam, spp, reference);
+    measure(builder, "qbvh", "bfs", qbvh, bvh, qbvh_seconds, mesh, cam, spp, reference);
+
+    // build time + reordering time, polygon indices change so mismatches compare t only
+    start = std::chrono::steady_clock::now();
+    mesh.reorder_polygons(bvh.reorder());
+    bvh_seconds += bench::seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    lumina::wide_bvh<lumina::wide_bvh_node> wide_dfs(bvh);
+    wide_dfs.reorder();
+    auto wide_dfs_seconds = bench::seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    lumina::qbvh qbvh_dfs(bvh);
+    qbvh_dfs.reorder();
+    auto qbvh_dfs_seconds = bench::seconds_since(start);
+
+    measure(builder, "bvh", "dfs", bvh, bvh, bvh_seconds, mesh, cam, spp, reference);
+    measure(builder, "wide_bvh", "dfs", wide_dfs, bvh, wide_dfs_seconds, mesh, cam, spp, reference);
+    measure(builder, "qbvh", "dfs", qbvh_dfs, bvh, qbvh_dfs_seconds, mesh, cam, spp, reference);
+}
+
+int main(int argc, const char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : bench::DEFAULT_SCENE;
+    lumina::u32 spp = argc > 2 ? std::stoul(argv[2]) : 4;
+    lumina::f32 alpha = argc > 3 ? std::stof(argv[3]) : lumina::bvh_options{}.alpha;
+
+    auto mesh = bench::load_mori_knob(path);
+    auto cam = bench::mori_knob_camera(IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    std::cout << "builder,accelerator,layout,nodes,node_bytes,references,duplicated_references,sah_cost,build_seconds,mean_child_distance_bytes,primary_cache_misses,primary_mrays_per_sec,path_mrays_per_sec,mismatches\n";
+
+    std::vector<hit_type> reference{};
+    measure_builder("median", {.split = lumina::bvh_split::median}, mesh, cam, spp, reference);
+    measure_builder("sah", {.split = lumina::bvh_split::sah}, mesh, cam, spp, reference);
+    measure_builder("sbvh", {.split = lumina::bvh_split::spatial, .alpha = alpha}, mesh, cam, spp, reference);
+
+    return 0;
+}
\ No newline at end of file
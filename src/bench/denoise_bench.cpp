@@ -0,0 +1,111 @@
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "bench_common.hpp"
+
+// equal-time error of path tracing with and without the denoiser
+// path rows: plain path tracing after spp samples per pixel
+// denoised rows: same samples plus one denoising pass, seconds include the pass
+// the last path row continues plain path tracing until the time of the last denoised row (equal time)
+// usage: lumina_denoise_bench [obj path] [denoised spp] [reference spp]
+// output (CSV): method,spp,seconds,rmse
+
+constexpr lumina::u32 IMAGE_WIDTH  = 160;
+constexpr lumina::u32 IMAGE_HEIGHT = 90;
+// same reconstruction filter as lumina
+constexpr lumina::film_filter FILTER{.type = lumina::film_filter_type::gaussian, .radius = 1.5f};
+// the reference uses its own scramble so its error does not correlate with the measured renders
+constexpr lumina::u64 RENDER_SEED    = 1;
+constexpr lumina::u64 REFERENCE_SEED = 2;
+
+struct progressive_renderer {
+    const lumina::camera& cam;
+    const lumina::bvh& bvh;
+    const lumina::mesh& mesh;
+    lumina::u64 seed;
+    lumina::film film;
+    lumina::u32 spp{};
+
+    progressive_renderer(const lumina::camera& cam, const lumina::bvh& bvh, const lumina::mesh& mesh, lumina::u64 seed)
+    : cam(cam), bvh(bvh), mesh(mesh), seed(seed), film(IMAGE_WIDTH, IMAGE_HEIGHT, {.filter = FILTER, .aovs = {.albedo = true, .normal = true, .variance = true}}) {}
+
+    // one sample per pixel, full range radiance like lumina
+    void pass() {
+        bench::parallel_for(IMAGE_HEIGHT, [&](lumina::u32, lumina::u32 y) {
+            lumina::sobol_sampler sampler(seed);
+            auto tile = film.tile(0, y, IMAGE_WIDTH, y + 1);
+            for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+                sampler.start_pixel_sample(x, y, spp);
+                auto position = lumina::camera::sample_position(x, y, sampler);
+                auto result = lumina::trace_ray(cam.generate_ray(position), bvh, mesh, sampler);
+                tile.add_sample(x, y, position, result.radiance, result.first_hit);
+            }
+            film.merge(tile);
+        });
+        ++spp;
+    }
+
+    std::vector<lumina::vec3f32> denoised() const {
+        return lumina::denoise(film.image(), film.albedo(), film.normal(), spp > 1 ? film.variance() : std::vector<lumina::f32>{}, IMAGE_WIDTH, IMAGE_HEIGHT);
+    }
+};
+
+lumina::f64 rmse(const std::vector<lumina::vec3f32>& image, const std::vector<lumina::vec3f32>& reference) {
+    lumina::f64 error{};
+    for(size_t i = 0; i < image.size(); ++i) {
+        auto d = image[i] - reference[i];
+        error += dot(d, d) / 3.0f;
+    }
+    return std::sqrt(error / lumina::f64(image.size()));
+}
+
+int main(int argc, const char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : bench::DEFAULT_SCENE;
+    lumina::u32 denoised_spp = argc > 2 ? std::stoul(argv[2]) : 64;
+    lumina::u32 reference_spp = argc > 3 ? std::stoul(argv[3]) : 4096;
+
+    auto mesh = bench::load_mori_knob(path);
+    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices);
+    auto cam = bench::mori_knob_camera(IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    std::clog << std::format("rendering reference ({} spp)...", reference_spp) << std::endl;
+    progressive_renderer reference_renderer(cam, bvh, mesh, REFERENCE_SEED);
+    while(reference_renderer.spp < reference_spp) {
+        reference_renderer.pass();
+    }
+    auto reference = reference_renderer.film.image();
+
+    std::cout << "method,spp,seconds,rmse\n";
+
+    progressive_renderer renderer(cam, bvh, mesh, RENDER_SEED);
+    lumina::f64 render_seconds{};
+    lumina::f64 denoised_seconds{};
+    while(renderer.spp < denoised_spp) {
+        auto start = std::chrono::steady_clock::now();
+        renderer.pass();
+        render_seconds += bench::seconds_since(start);
+
+        if((renderer.spp & (renderer.spp - 1)) == 0 || renderer.spp == denoised_spp) {
+            std::cout << std::format("path,{},{:.3f},{:.6f}\n", renderer.spp, render_seconds, rmse(renderer.film.image(), reference));
+
+            auto denoise_start = std::chrono::steady_clock::now();
+            auto denoised = renderer.denoised();
+            auto denoise_seconds = bench::seconds_since(denoise_start);
+            denoised_seconds = render_seconds + denoise_seconds;
+            std::cout << std::format("denoised,{},{:.3f},{:.6f}\n", renderer.spp, denoised_seconds, rmse(denoised, reference)) << std::flush;
+            std::clog << std::format("denoising: {:.1f} ms ({:.1f}% of the render time)", denoise_seconds * 1000.0, denoise_seconds / render_seconds * 100.0) << std::endl;
+        }
+    }
+
+    // equal time: plain path tracing with the time of the denoised image
+    while(render_seconds < denoised_seconds) {
+        auto start = std::chrono::steady_clock::now();
+        renderer.pass();
+        render_seconds += bench::seconds_since(start);
+    }
+    std::cout << std::format("path,{},{:.3f},{:.6f}\n", renderer.spp, render_seconds, rmse(renderer.film.image(), reference));
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "bench_common.hpp"
+
+// memory vs. ray throughput of full precision geometry (mesh + bvh) and compressed_mesh
+// usage: lumina_geometry_bench [obj path] [spp]
+// output (CSV): geometry,bytes,bytes_per_polygon,primary_mrays_per_sec,path_mrays_per_sec,mean_radiance
+
+constexpr lumina::u32 IMAGE_WIDTH  = 160;
+constexpr lumina::u32 IMAGE_HEIGHT = 90;
+
+// trace(ray) -> hit or not, path(ray, sampler) -> path_result
+template<class Trace, class Path>
+void measure(const char* name, lumina::usize bytes, lumina::usize polygons, const lumina::camera& cam, lumina::u32 spp, Trace&& trace, Path&& path) {
+    // primary rays only
+    std::atomic<lumina::u64> hits{};
+    auto start = std::chrono::steady_clock::now();
+    bench::parallel_for(IMAGE_HEIGHT, [&](lumina::u32, lumina::u32 y) {
+        lumina::sobol_sampler sampler(1);
+        lumina::u64 local_hits{};
+        for(lumina::u32 s = 0; s < spp; ++s) {
+            for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+                sampler.start_pixel_sample(x, y, s);
+                local_hits += trace(cam.generate_ray(x, y, sampler)) ? 1 : 0;
+            }
+        }
+        hits += local_hits;
+    });
+    auto primary_seconds = bench::seconds_since(start);
+    auto primary_rays = lumina::f64(IMAGE_WIDTH) * IMAGE_HEIGHT * spp;
+
+    // full paths, every traced ray counts
+    std::atomic<lumina::u64> rays{};
+    std::vector<lumina::vec3f32> image(IMAGE_WIDTH * IMAGE_HEIGHT);
+    start = std::chrono::steady_clock::now();
+    bench::parallel_for(IMAGE_HEIGHT, [&](lumina::u32, lumina::u32 y) {
+        lumina::sobol_sampler sampler(1);
+        lumina::u64 local_rays{};
+        for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+            for(lumina::u32 s = 0; s < spp; ++s) {
+                sampler.start_pixel_sample(x, y, s);
+                auto result = path(cam.generate_ray(x, y, sampler), sampler);
+                image[y * IMAGE_WIDTH + x] += lumina::min(result.radiance, lumina::vec3f32(1.0f)) / lumina::f32(spp);
+                local_rays += result.length;
+            }
+        }
+        rays += local_rays;
+    });
+    auto path_seconds = bench::seconds_since(start);
+
+    lumina::f64 mean{};
+    for(const auto& p : image) {
+        mean += (p.r + p.g + p.b) / 3.0f;
+    }
+    mean /= lumina::f64(image.size());
+
+    std::cout << std::format("{},{},{:.1f},{:.3f},{:.3f},{:.6f}\n", name, bytes, lumina::f64(bytes) / lumina::f64(polygons), primary_rays / primary_seconds / 1.0e6, lumina::f64(rays) / path_seconds / 1.0e6, mean) << std::flush;
+}
+
+int main(int argc, const char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : bench::DEFAULT_SCENE;
+    lumina::u32 spp = argc > 2 ? std::stoul(argv[2]) : 4;
+
+    auto mesh = bench::load_mori_knob(path);
+    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices);
+    // leaf order as in main.cpp, vertices numbered by first use keep the vertex blocks of compressed_mesh tight
+    mesh.reorder_polygons(bvh.reorder());
+    lumina::compressed_mesh compressed(mesh, bvh);
+    auto cam = bench::mori_knob_camera(IMAGE_WIDTH, IMAGE_HEIGHT);
+    auto polygons = std::max<lumina::usize>(1, mesh.vertex_indices.size());
+
+    std::cout << "geometry,bytes,bytes_per_polygon,primary_mrays_per_sec,path_mrays_per_sec,mean_radiance\n";
+
+    measure("full", mesh.resident_bytes() + bvh.nodes().size_bytes(), polygons, cam, spp,
+        [&](const lumina::ray& r) { return bvh.trace(mesh.vertices, mesh.vertex_indices, r, lumina::F32_MAX).has_value(); },
+        [&](const lumina::ray& r, lumina::sobol_sampler& sampler) { return lumina::trace_ray(r, bvh, mesh, sampler); }
+    );
+    measure("compressed", compressed.resident_bytes(), polygons, cam, spp,
+        [&](const lumina::ray& r) { return compressed.trace(r, lumina::F32_MAX).has_value(); },
+        [&](const lumina::ray& r, lumina::sobol_sampler& sampler) { return lumina::trace_ray(r, compressed, sampler); }
+    );
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+
+// kdtree build time (all hardware threads) and query throughput (single thread) on uniform random points in the unit cube
+// results of the first CHECKED_QUERIES queries are compared with brute force search
+// usage: lumina_kdtree_bench [points] [queries]
+// output (CSV): query,parameter,points,queries_per_sec,mean_results,mismatches
+// parameter: k of knn / radius of radius queries (chosen for about 50 points per query), build row: seconds
+
+constexpr lumina::u32 CHECKED_QUERIES = 100;
+constexpr lumina::u32 MAX_K = 100;
+
+// keeps the optimizer from removing benchmarked work
+volatile lumina::f32 sink{};
+
+// squared distances of the k nearest points, ascending
+std::vector<lumina::f32> brute_force_knn(const std::vector<lumina::vec3f32>& points, const lumina::vec3f32& query, lumina::u32 k) {
+    std::vector<lumina::f32> d2(points.size());
+    for(size_t i = 0; i < points.size(); ++i) {
+        auto d = points[i] - query;
+        d2[i] = lumina::dot(d, d);
+    }
+    auto n = std::min<size_t>(k, d2.size());
+    std::partial_sort(d2.begin(), d2.begin() + n, d2.end());
+    d2.resize(n);
+    return d2;
+}
+
+lumina::u32 brute_force_radius(const std::vector<lumina::vec3f32>& points, const lumina::vec3f32& query, lumina::f32 radius) {
+    lumina::u32 count{};
+    for(const auto& p : points) {
+        auto d = p - query;
+        count += lumina::dot(d, d) <= radius * radius ? 1 : 0;
+    }
+    return count;
+}
+
+int main(int argc, const char* argv[]) {
+    lumina::u32 point_count = argc > 1 ? std::stoul(argv[1]) : 1 << 20;
+    lumina::u32 query_count = argc > 2 ? std::stoul(argv[2]) : 1 << 18;
+    // every query expects at least one point
+    if(point_count == 0 || query_count == 0) {
+        std::clog << "points and queries have to be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // fixed random inputs
+    lumina::xoshiro256pp rng(42);
+    auto random_point = [&] { return lumina::vec3f32(lumina::uniform_1d(rng), lumina::uniform_1d(rng), lumina::uniform_1d(rng)); };
+    std::vector<lumina::vec3f32> points(point_count);
+    std::generate(points.begin(), points.end(), random_point);
+    std::vector<lumina::vec3f32> queries(query_count);
+    std::generate(queries.begin(), queries.end(), random_point);
+    auto checked = std::min(CHECKED_QUERIES, query_count);
+
+    std::cout << "query,parameter,points,queries_per_sec,mean_results,mismatches\n";
+
+    auto start = std::chrono::steady_clock::now();
+    lumina::kdtree tree(points);
+    std::cout << std::format("build,{:.4f},{},0,0,0\n", bench::seconds_since(start), point_count) << std::flush;
+
+    // nearest point
+    {
+        lumina::f32 acc{};
+        start = std::chrono::steady_clock::now();
+        for(const auto& q : queries) {
+            acc += tree.nn_search(q)->distance2;
+        }
+        auto seconds = bench::seconds_since(start);
+        sink = acc;
+
+        lumina::u32 mismatches{};
+        for(lumina::u32 i = 0; i < checked; ++i) {
+            auto nearest = tree.nn_search(queries[i]);
+            auto d = points[*nearest->payload] - queries[i];
+            mismatches += nearest->distance2 != brute_force_knn(points, queries[i], 1)[0] || lumina::dot(d, d) != nearest->distance2 ? 1 : 0;
+        }
+        std::cout << std::format("nn,1,{},{:.0f},1,{}\n", point_count, query_count / seconds, mismatches) << std::flush;
+    }
+
+    // k nearest points, result buffer reused by every query
+    std::vector<lumina::kdtree_neighbor<lumina::u32>> buffer(MAX_K);
+    for(lumina::u32 k : {1u, 8u, 32u, MAX_K}) {
+        auto result = std::span(buffer).first(k);
+        lumina::f32 acc{};
+        lumina::u64 found{};
+        start = std::chrono::steady_clock::now();
+        for(const auto& q : queries) {
+            auto neighbors = tree.knn_search(q, result);
+            acc += neighbors.back().distance2;
+            found += neighbors.size();
+        }
+        auto seconds = bench::seconds_since(start);
+        sink = acc;
+
+        lumina::u32 mismatches{};
+        for(lumina::u32 i = 0; i < checked; ++i) {
+            auto neighbors = tree.knn_search(queries[i], result);
+            auto expected = brute_force_knn(points, queries[i], k);
+            auto same = neighbors.size() == expected.size() && std::equal(neighbors.begin(), neighbors.end(), expected.begin(), [](const auto& n, auto d2) { return n.distance2 == d2; });
+            mismatches += same ? 0 : 1;
+        }
+        std::cout << std::format("knn,{},{},{:.0f},{:.1f},{}\n", k, point_count, query_count / seconds, lumina::f64(found) / query_count, mismatches) << std::flush;
+    }
+
+    // fixed radius, about 50 points per query inside the cube
+    {
+        auto radius = static_cast<lumina::f32>(std::cbrt(50.0 * 3.0 / (4.0 * lumina::F64_PI * point_count)));
+        lumina::u64 found{};
+        start = std::chrono::steady_clock::now();
+        for(const auto& q : queries) {
+            tree.radius_search(q, radius, [&](lumina::u32, lumina::f32) { ++found; });
+        }
+        auto seconds = bench::seconds_since(start);
+
+        lumina::u32 mismatches{};
+        for(lumina::u32 i = 0; i < checked; ++i) {
+            lumina::u32 count{};
+            tree.radius_search(queries[i], radius, [&](lumina::u32, lumina::f32) { ++count; });
+            mismatches += count != brute_force_radius(points, queries[i], radius) ? 1 : 0;
+        }
+        std::cout << std::format("radius,{:.5f},{},{:.0f},{:.1f},{}\n", radius, point_count, query_count / seconds, lumina::f64(found) / query_count, mismatches) << std::flush;
+    }
+
+    return 0;
+}
\ No newline at end of file
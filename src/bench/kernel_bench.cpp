@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "../lumina/lumina.hpp"
+
+// per-call cost of the innermost kernels: intersection tests, direction sampling, basis construction and random number generators
+// every kernel runs on the same fixed random inputs (cache resident), best of REPEATS runs
+// sampling kernels include drawing their random numbers from xoshiro256pp
+// usage: lumina_kernel_bench
+// output (CSV): kernel,ns_per_op,ops_per_sec
+// baseline: loop and input loads only, subtract it to compare very cheap kernels
+
+constexpr lumina::u32 INPUTS     = 1 << 12;
+constexpr lumina::u32 ITERATIONS = 1 << 24;
+constexpr lumina::u32 REPEATS    = 5;
+
+// keeps the optimizer from removing benchmarked work
+volatile lumina::f32 sink{};
+volatile lumina::u64 sink_u64{};
+
+// f(i) -> f32 or u64, results are accumulated into a sink
+template<class F>
+void measure(const char* name, F&& f) {
+    auto best = lumina::F64_MAX;
+    for(lumina::u32 r = 0; r < REPEATS; ++r) {
+        decltype(f(0)) acc{};
+        auto start = std::chrono::steady_clock::now();
+        for(lumina::u32 i = 0; i < ITERATIONS; ++i) {
+            acc += f(i & (INPUTS - 1));
+        }
+        auto seconds = std::chrono::duration<lumina::f64>(std::chrono::steady_clock::now() - start).count();
+        if constexpr(std::is_same_v<decltype(acc), lumina::u64>) {
+            sink_u64 = acc;
+        }
+        else {
+            sink = acc;
+        }
+        best = std::min(best, seconds);
+    }
+
+    std::cout << std::format("{},{:.3f},{:.0f}\n", name, best / ITERATIONS * 1.0e9, ITERATIONS / best) << std::flush;
+}
+
+lumina::f32 sum(const lumina::vec3f32& v) {
+    return v.x + v.y + v.z;
+}
+
+int main() {
+    // fixed random inputs
+    lumina::xoshiro256pp rng(42);
+    auto uniform = [&](lumina::f32 min, lumina::f32 max) { return min + (max - min) * lumina::uniform_1d(rng); };
+    auto point = [&](lumina::f32 extent) { return lumina::vec3f32(uniform(-extent, extent), uniform(-extent, extent), uniform(-extent, extent)); };
+
+    lumina::frame z_up(lumina::vec3f32(0.0f, 0.0f, 1.0f));
+    std::vector<lumina::ray> rays(INPUTS);
+    std::vector<lumina::aabb> boxes(INPUTS);
+    std::vector<lumina::triangle> triangles(INPUTS);
+    std::vector<lumina::sphere> spheres(INPUTS);
+    std::vector<lumina::vec3f32> normals(INPUTS);
+    std::vector<lumina::vec3f32> directions(INPUTS);
+    std::vector<lumina::frame> frames(INPUTS);
+    for(lumina::u32 i = 0; i < INPUTS; ++i) {
+        // rays from a shell around the origin towards the origin region, roughly half of the tests hit
+        auto origin = lumina::normalize(point(1.0f)) * 4.0f;
+        rays[i] = lumina::ray(origin, lumina::normalize(point(1.0f) - origin));
+
+        auto center = point(1.0f);
+        auto half = lumina::vec3f32(uniform(0.05f, 0.5f), uniform(0.05f, 0.5f), uniform(0.05f, 0.5f));
+        boxes[i] = lumina::aabb(center - half, center + half);
+
+        auto p0 = point(1.0f);
+        triangles[i] = lumina::triangle(p0, p0 + point(0.5f), p0 + point(0.5f));
+
+        spheres[i] = lumina::sphere(point(1.0f), uniform(0.1f, 0.5f));
+
+        normals[i] = lumina::normalize(point(1.0f));
+        directions[i] = lumina::sample_cosine_hemisphere(z_up, rng);
+        frames[i] = lumina::frame(normals[i]);
+    }
+
+    std::cout << "kernel,ns_per_op,ops_per_sec\n";
+
+    measure("baseline", [&](lumina::u32 i) { return rays[i].direction.x; });
+
+    // intersection
+    measure("intersect_ray_aabb", [&](lumina::u32 i) { return lumina::intersect(rays[i], boxes[i]).value_or(0.0f); });
+    measure("intersect_ray_triangle", [&](lumina::u32 i) { return lumina::intersect(rays[i], triangles[i]).value_or(0.0f); });
+    measure("intersect_ray_sphere", [&](lumina::u32 i) { return lumina::intersect(rays[i], spheres[i]).value_or(0.0f); });
+
+    // basis
+    measure("frame", [&](lumina::u32 i) { return sum(lumina::frame(normals[i]).s); });
+    measure("onb", [&](lumina::u32 i) { return sum(lumina::onb(normals[i], directions[i])); });
+    measure("frame_to_world", [&](lumina::u32 i) { return sum(frames[i].to_world(directions[i])); });
+
+    // sampling
+    measure("sample_uniform_sphere", [&](lumina::u32 i) { return sum(lumina::sample_uniform_sphere(frames[i], rng)); });
+    measure("sample_uniform_hemisphere", [&](lumina::u32 i) { return sum(lumina::sample_uniform_hemisphere(frames[i], rng)); });
+    measure("sample_cosine_hemisphere", [&](lumina::u32 i) { return sum(lumina::sample_cosine_hemisphere(frames[i], rng)); });
+    measure("sample_uniform_rectangle", [&](lumina::u32 i) { return sum(lumina::sample_uniform_rectangle(triangles[i].p0, triangles[i].p1 - triangles[i].p0, triangles[i].p2 - triangles[i].p0, rng)); });
+    measure("sample_uniform_triangle", [&](lumina::u32 i) { return sum(lumina::sample_uniform_triangle(triangles[i].p0, triangles[i].p1 - triangles[i].p0, triangles[i].p2 - triangles[i].p0, rng)); });
+    measure("sample_heitz_triangle", [&](lumina::u32 i) { return sum(lumina::sample_heitz_triangle(triangles[i].p0, triangles[i].p1, triangles[i].p2, rng)); });
+    measure("sample_ggx", [&](lumina::u32 i) { return std::get<2>(lumina::sample_ggx(directions[i], z_up, 0.5f, rng)); });
+
+    // random number generators, raw 64-bit outputs
+    lumina::xoshiro256pp xoshiro256pp(1);
+    lumina::xoshiro256p xoshiro256p(1);
+    lumina::xoroshiro128pp xoroshiro128pp(1);
+    measure("xoshiro256pp", [&](lumina::u32) { return xoshiro256pp(); });
+    measure("xoshiro256p", [&](lumina::u32) { return xoshiro256p(); });
+    measure("xoroshiro128pp", [&](lumina::u32) { return xoroshiro128pp(); });
+    measure("xoshiro256pp_uniform_1d", [&](lumina::u32) { return lumina::uniform_1d(xoshiro256pp); });
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <vector>
+
+#include "../lumina/lumina.hpp"
+
+// GGX evaluation throughput and sampling variance, closed form + VNDF vs. previous implementation
+// usage: lumina_microfacet_bench
+// output (CSV): two tables, "kernel,evaluations_per_sec" and "roughness,cos_o,method,mean,variance,wasted"
+
+// previous implementation (trigonometric D/G1, full NDF sampling), kept as baseline
+namespace legacy {
+
+using namespace lumina;
+
+inline f32 g1(const vec3f32& v, const vec3f32& m, const vec3f32& n, f32 alpha) {
+    auto theta_v = std::acos(dot(v, n));
+
+    auto coef = std::max(0.0f, dot(v, m) / dot(v, n));
+    auto denominator = 1.0f + std::sqrt(1.0f + alpha * alpha * std::tan(theta_v) * std::tan(theta_v));
+
+    return coef * (2.0f / denominator);
+}
+
+inline f32 d(const vec3f32& m, const vec3f32& n, f32 alpha) {
+    auto theta_m = std::acos(dot(m, n));
+
+    auto numerator = alpha * alpha * std::max(0.0f, dot(m, n));
+    auto denominator1 = F32_PI * std::pow(std::cos(theta_m), 4.0f);
+    auto denominator2 = (alpha * alpha + std::tan(theta_m) * std::tan(theta_m));
+
+    return numerator / (denominator1 * (denominator2 * denominator2));
+}
+
+template<class RandGen>
+inline std::tuple<vec3f32, vec3f32, f32> sample_ggx(const vec3f32& omega_o, const vec3f32& n, f32 roughness, RandGen& rng) {
+    auto alpha = roughness * roughness;
+
+    auto u = uniform_2d(rng);
+
+    auto theta = std::atan(alpha * std::sqrt(u.x) / std::sqrt(1.0f - u.x));
+    auto phi = 2.0f * F32_PI * u.y;
+
+    auto m = onb(n, {std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)});
+    auto omega_i = reflect(-omega_o, m);
+
+    auto pdf_val = (lumina::d(m, n, alpha) * std::abs(dot(m, n))) / (4.0f * std::abs(dot(omega_o, m)));
+
+    return { m, omega_i, pdf_val };
+}
+
+}
+
+constexpr lumina::u32 EVALUATIONS = 1 << 22;
+constexpr lumina::u32 ESTIMATES   = 1 << 20;
+
+// keeps the optimizer from removing benchmarked work
+volatile lumina::f32 sink{};
+
+template<class F>
+void measure(const char* name, F&& f) {
+    lumina::f32 acc{};
+    auto start = std::chrono::steady_clock::now();
+    for(lumina::u32 i = 0; i < EVALUATIONS; ++i) {
+        acc += f(i);
+    }
+    auto seconds = std::chrono::duration<lumina::f64>(std::chrono::steady_clock::now() - start).count();
+    sink = acc;
+
+    std::cout << std::format("{},{:.0f}\n", name, EVALUATIONS / seconds);
+}
+
+// estimates directional albedo of GGX reflection with F = 1 (ideally close to 1 for small roughness)
+// estimator: f * cos_i / pdf, f = D * G2 / (4 * cos_o * cos_i)
+template<class Sample>
+void estimate(lumina::f32 roughness, lumina::f32 cos_o, const char* name, Sample&& sample) {
+    lumina::xoshiro256pp rng(0x5eed);
+
+    auto alpha = std::max(roughness * roughness, lumina::GGX_MIN_ALPHA);
+    lumina::vec3f32 n(0.0f, 0.0f, 1.0f);
+    lumina::frame shading(n);
+    lumina::vec3f32 omega_o(std::sqrt(1.0f - cos_o * cos_o), 0.0f, cos_o);
+
+    lumina::f64 sum{};
+    lumina::f64 sum_sq{};
+    lumina::u32 wasted{};
+    for(lumina::u32 i = 0; i < ESTIMATES; ++i) {
+        auto [m, omega_i, pdf_val] = sample(omega_o, shading, roughness, rng);
+        auto cos_i = dot(omega_i, n);
+
+        lumina::f64 w{};
+        if(cos_i <= 0.0f || pdf_val <= 0.0f) {
+            ++wasted;
+        }
+        else {
+            auto f = lumina::d(m, n, alpha) * lumina::g2(omega_i, omega_o, m, n, alpha) / (4.0f * cos_o * cos_i);
+            w = f * cos_i / pdf_val;
+        }
+
+        sum += w;
+        sum_sq += w * w;
+    }
+
+    auto mean = sum / ESTIMATES;
+    auto variance = sum_sq / ESTIMATES - mean * mean;
+    std::cout << std::format("{},{},{},{:.6f},{:.6f},{:.4f}\n", roughness, cos_o, name, mean, variance, lumina::f64(wasted) / ESTIMATES);
+}
+
+int main() {
+    // fixed random inputs
+    lumina::xoshiro256pp rng(42);
+    std::vector<lumina::vec3f32> ms(EVALUATIONS);
+    std::vector<lumina::vec3f32> vs(EVALUATIONS);
+    lumina::vec3f32 n(0.0f, 0.0f, 1.0f);
+    lumina::frame shading(n);
+    for(lumina::u32 i = 0; i < EVALUATIONS; ++i) {
+        ms[i] = lumina::sample_cosine_hemisphere(shading, rng);
+        vs[i] = lumina::sample_uniform_hemisphere(shading, rng);
+    }
+    constexpr lumina::f32 alpha = 0.25f;
+
+    std::cout << "kernel,evaluations_per_sec\n";
+    measure("d_legacy", [&](lumina::u32 i) { return legacy::d(ms[i], n, alpha); });
+    measure("d", [&](lumina::u32 i) { return lumina::d(ms[i], n, alpha); });
+    measure("g1_legacy", [&](lumina::u32 i) { return legacy::g1(vs[i], ms[i], n, alpha); });
+    measure("g1", [&](lumina::u32 i) { return lumina::g1(vs[i], ms[i], n, alpha); });
+    measure("g2", [&](lumina::u32 i) { return lumina::g2(vs[i], vs[EVALUATIONS - 1 - i], ms[i], n, alpha); });
+    measure("sample_ggx_legacy", [&](lumina::u32 i) { return std::get<2>(legacy::sample_ggx(vs[i], n, 0.5f, rng)); });
+    measure("sample_ggx", [&](lumina::u32 i) { return std::get<2>(lumina::sample_ggx(vs[i], shading, 0.5f, rng)); });
+
+    std::cout << "\nroughness,cos_o,method,mean,variance,wasted\n";
+    for(auto roughness : {0.1f, 0.3f, 0.6f, 1.0f}) {
+        for(auto cos_o : {0.9f, 0.5f, 0.1f}) {
+            estimate(roughness, cos_o, "ndf", [](const auto& omega_o, const auto& shading, auto roughness, auto& rng) { return legacy::sample_ggx(omega_o, shading.n, roughness, rng); });
+            estimate(roughness, cos_o, "vndf", [](auto&&... args) { return lumina::sample_ggx(args...); });
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
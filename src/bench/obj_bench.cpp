@@ -0,0 +1,87 @@
+#include <format>
+#include <iostream>
+
+#include "bench_common.hpp"
+
+// OBJ loading throughput, load_obj vs. load_obj_parallel, and mapping the converted binary mesh (load_mesh_binary)
+// usage: lumina_obj_bench [obj path] [repeat]
+// bytes of load_mesh_binary are the size of the .lmesh file written to the temporary directory
+// followed by bytes per polygon of mesh geometry (CSV): layout,bytes,bytes_per_polygon
+// output (CSV): loader,bytes,seconds,mb_per_sec
+
+template<class Loader>
+lumina::obj_contents measure(const char* name, const char* path, lumina::u32 repeat, Loader&& loader) {
+    auto bytes = std::filesystem::file_size(path);
+
+    lumina::obj_contents contents{};
+    auto best = lumina::F64_MAX;
+    for(lumina::u32 i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        contents = loader(path);
+        best = std::min(best, bench::seconds_since(start));
+    }
+
+    std::cout << std::format("{},{},{:.4f},{:.1f}\n", name, bytes, best, lumina::f64(bytes) / best / 1.0e6) << std::flush;
+
+    return contents;
+}
+
+int main(int argc, const char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : bench::DEFAULT_SCENE;
+    lumina::u32 repeat = argc > 2 ? std::stoul(argv[2]) : 3;
+
+    std::cout << "loader,bytes,seconds,mb_per_sec\n";
+    auto serial = measure("load_obj", path, repeat, lumina::load_obj);
+    auto parallel = measure("load_obj_parallel", path, repeat, lumina::load_obj_parallel);
+
+    // both loaders have to agree
+    auto same_vec3 = [](const auto& a, const auto& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const auto& x, const auto& y) { return x.x == y.x && x.y == y.y && x.z == y.z; });
+    };
+    auto identical =
+        same_vec3(std::get<0>(serial), std::get<0>(parallel)) &&
+        std::get<1>(serial).size() == std::get<1>(parallel).size() &&
+        same_vec3(std::get<2>(serial), std::get<2>(parallel)) &&
+        same_vec3(std::get<3>(serial), std::get<3>(parallel)) &&
+        same_vec3(std::get<4>(serial), std::get<4>(parallel)) &&
+        same_vec3(std::get<5>(serial), std::get<5>(parallel)) &&
+        std::get<6>(serial) == std::get<6>(parallel);
+
+    if(!identical) {
+        std::clog << "load_obj_parallel result differs from load_obj" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto binary_path = (std::filesystem::temp_directory_path() / "lumina_obj_bench.lmesh").string();
+    lumina::convert_obj_to_binary(path, binary_path.c_str());
+
+    auto binary_bytes = std::filesystem::file_size(binary_path);
+    auto best = lumina::F64_MAX;
+    for(lumina::u32 i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        auto mesh = lumina::load_mesh_binary(binary_path.c_str());
+        best = std::min(best, bench::seconds_since(start));
+
+        if(!mesh || mesh->vertex_indices.size() != std::get<3>(serial).size()) {
+            std::clog << "load_mesh_binary result differs from load_obj" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << std::format("{},{},{:.6f},{:.1f}\n", "load_mesh_binary", binary_bytes, best, lumina::f64(binary_bytes) / best / 1.0e6) << std::flush;
+
+    std::filesystem::remove(binary_path);
+
+    // memory of mesh geometry, separate optional<vec3u32> attribute indices (previous layout) vs. unified index buffer
+    const auto& [vertices, texcoords, normals, vertex_indices, texcoord_indices, normal_indices, mesh_groups] = serial;
+    auto polygons = lumina::f64(std::max<lumina::usize>(1, vertex_indices.size()));
+    auto separate_bytes =
+        vertices.size() * sizeof(lumina::vec3f32) + texcoords.size() * sizeof(lumina::vec2f32) + normals.size() * sizeof(lumina::vec3f32) +
+        vertex_indices.size() * (sizeof(lumina::vec3u32) + 2 * sizeof(std::optional<lumina::vec3u32>) + sizeof(lumina::u32) + sizeof(lumina::vec4f32));
+    auto unified_bytes = lumina::mesh(std::move(parallel)).resident_bytes();
+
+    std::cout << "\nlayout,bytes,bytes_per_polygon\n";
+    std::cout << std::format("{},{},{:.1f}\n", "separate_optional_indices", separate_bytes, lumina::f64(separate_bytes) / polygons);
+    std::cout << std::format("{},{},{:.1f}\n", "unified_indices", unified_bytes, lumina::f64(unified_bytes) / polygons) << std::flush;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "bench_common.hpp"
+
+// equal-time error comparison of sample generators
+// usage: lumina_sampler_bench [obj path] [seconds per sampler] [reference spp]
+// output (CSV): sampler,spp,seconds,rmse
+
+constexpr lumina::u32 IMAGE_WIDTH  = 160;
+constexpr lumina::u32 IMAGE_HEIGHT = 90;
+
+struct render_result {
+    std::vector<lumina::vec3f32> sum;
+    lumina::u32 spp;
+};
+
+// progressive rendering, one sample per pixel per pass, until the time budget is exhausted
+// on_pass(spp, elapsed seconds, accumulated sum) is called after every power-of-two pass
+template<class Sampler, class OnPass>
+render_result render(const lumina::camera& cam, const lumina::bvh& bvh, const lumina::mesh& mesh, lumina::u64 seed, lumina::f64 budget, lumina::u32 max_spp, OnPass&& on_pass) {
+    std::vector<lumina::vec3f32> sum(IMAGE_WIDTH * IMAGE_HEIGHT);
+    lumina::u32 spp{};
+
+    auto start = std::chrono::steady_clock::now();
+    while(spp < max_spp && bench::seconds_since(start) < budget) {
+        bench::parallel_for(IMAGE_HEIGHT, [&](lumina::u32, lumina::u32 y) {
+            Sampler sampler(seed);
+            for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+                sampler.start_pixel_sample(x, y, spp);
+                auto ray = cam.generate_ray(x, y, sampler);
+                sum[y * IMAGE_WIDTH + x] += lumina::min(lumina::trace_ray(ray, bvh, mesh, sampler).radiance, lumina::vec3f32(1.0f));
+            }
+        });
+        ++spp;
+
+        if((spp & (spp - 1)) == 0) {
+            on_pass(spp, bench::seconds_since(start), sum);
+        }
+    }
+
+    return { std::move(sum), spp };
+}
+
+lumina::f64 rmse(const std::vector<lumina::vec3f32>& sum, lumina::u32 spp, const std::vector<lumina::vec3f32>& reference) {
+    lumina::f64 error{};
+    for(size_t i = 0; i < sum.size(); ++i) {
+        auto d = sum[i] / lumina::f32(spp) - reference[i];
+        error += dot(d, d) / 3.0f;
+    }
+    return std::sqrt(error / lumina::f64(sum.size()));
+}
+
+template<class Sampler>
+void compare(const char* name, const lumina::camera& cam, const lumina::bvh& bvh, const lumina::mesh& mesh, lumina::f64 budget, const std::vector<lumina::vec3f32>& reference) {
+    auto start = std::chrono::steady_clock::now();
+    auto [sum, spp] = render<Sampler>(cam, bvh, mesh, 1, budget, lumina::U32_MAX, [&](lumina::u32 spp, lumina::f64 seconds, const auto& sum) {
+        std::cout << std::format("{},{},{:.3f},{:.6f}\n", name, spp, seconds, rmse(sum, spp, reference));
+    });
+    // equal-time result
+    std::cout << std::format("{},{},{:.3f},{:.6f}\n", name, spp, bench::seconds_since(start), rmse(sum, spp, reference)) << std::flush;
+}
+
+int main(int argc, const char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : bench::DEFAULT_SCENE;
+    lumina::f64 budget = argc > 2 ? std::stod(argv[2]) : 10.0;
+    lumina::u32 reference_spp = argc > 3 ? std::stoul(argv[3]) : 4096;
+
+    auto mesh = bench::load_mori_knob(path);
+    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices);
+    auto cam = bench::mori_knob_camera(IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    std::clog << std::format("rendering reference ({} spp)...", reference_spp) << std::endl;
+    auto [reference, spp] = render<lumina::sobol_sampler>(cam, bvh, mesh, 0x5eed, lumina::F64_MAX, reference_spp, [](auto...) {});
+    for(auto& p : reference) {
+        p /= lumina::f32(spp);
+    }
+
+    std::cout << "sampler,spp,seconds,rmse\n";
+    compare<lumina::independent_sampler<lumina::xoshiro256pp>>("xoshiro256pp", cam, bvh, mesh, budget, reference);
+    compare<lumina::sobol_sampler>("sobol", cam, bvh, mesh, budget, reference);
+    compare<lumina::rank1_sampler>("rank1", cam, bvh, mesh, budget, reference);
+
+    return 0;
+}
\ No newline at end of file
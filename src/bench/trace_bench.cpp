@@ -0,0 +1,236 @@
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "bench_common.hpp"
+
+// ray throughput suite for tracking regressions between commits
+// every bvh builder (median, sah, sbvh) x every accelerator (bvh, wide_bvh, qbvh) traces the same fixed ray sets
+// - primary: camera rays
+// - diffuse: cosine distributed bounces from the primary hits
+// - shadow: primary hits -> points on emissive polygons, limited to the light distance (closest hit traversal, no any hit)
+// accelerators are laid out as in main.cpp (bvh::reorder(), polygons in leaf order)
+// usage: lumina_trace_bench [obj path] [spp] [csv|json]
+// output (CSV): builder,accelerator,build_seconds,nodes,node_bytes,ray_set,rays,hits,mrays_per_sec,nodes_per_ray,triangles_per_ray
+// output (JSON): {"scene": ..., "results": [{same keys as CSV}, ...]}
+// build_seconds: binary bvh build + reorder for bvh, collapse + reorder for wide_bvh / qbvh
+// hits: should be identical for every accelerator of a ray set
+
+constexpr lumina::u32 IMAGE_WIDTH  = 160;
+constexpr lumina::u32 IMAGE_HEIGHT = 90;
+// rays per parallel_for item
+constexpr lumina::u32 CHUNK_SIZE = 1024;
+// same offset as the integrator
+constexpr lumina::f32 RAY_EPS = 0.0001f;
+
+struct ray_set {
+    const char* name;
+    std::vector<lumina::ray> rays;
+    std::vector<lumina::f32> t_max;
+};
+
+struct result_row {
+    std::string builder;
+    std::string accelerator;
+    lumina::f64 build_seconds;
+    lumina::usize nodes;
+    lumina::usize node_bytes;
+    std::string ray_set;
+    lumina::usize rays;
+    lumina::u64 hits;
+    lumina::f64 mrays_per_sec;
+    lumina::f64 nodes_per_ray;
+    lumina::f64 triangles_per_ray;
+};
+
+// primary rays of the benchmark camera, diffuse and shadow rays from their hits on the median bvh
+std::vector<ray_set> generate_ray_sets(const lumina::mesh& mesh, const lumina::camera& cam, lumina::u32 spp) {
+    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices);
+
+    ray_set primary{"primary", {}, {}};
+    ray_set diffuse{"diffuse", {}, {}};
+    ray_set shadow{"shadow", {}, {}};
+
+    // emissive polygons, shadow rays aim above the scene without them
+    std::vector<lumina::u32> lights{};
+    lumina::aabb bounds{};
+    for(lumina::u32 i = 0; i < mesh.vertex_indices.size(); ++i) {
+        const auto& e = mesh.material(i).emission;
+        if(std::max({e.x, e.y, e.z}) > 0.0f) {
+            lights.push_back(i);
+        }
+    }
+    for(const auto& v : mesh.vertices) {
+        bounds += lumina::aabb(v, v);
+    }
+
+    lumina::sobol_sampler sampler(1);
+    lumina::xoshiro256pp rng(1);
+    for(lumina::u32 s = 0; s < spp; ++s) {
+        for(lumina::u32 y = 0; y < IMAGE_HEIGHT; ++y) {
+            for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+                sampler.start_pixel_sample(x, y, s);
+                auto r = cam.generate_ray(x, y, sampler);
+                primary.rays.push_back(r);
+                primary.t_max.push_back(lumina::F32_MAX);
+
+                auto hit = bvh.trace(mesh.vertices, mesh.vertex_indices, r, lumina::F32_MAX);
+                if(!hit) {
+                    continue;
+                }
+
+                const auto& index = mesh.vertex_indices[hit->first];
+                const auto& p0 = mesh.vertices[index.x];
+                const auto& p1 = mesh.vertices[index.y];
+                const auto& p2 = mesh.vertices[index.z];
+                auto n = lumina::normalize(lumina::cross(p1 - p0, p2 - p0));
+                if(lumina::dot(n, r.direction) > 0.0f) {
+                    n = -n;
+                }
+                auto origin = r[hit->second] + n * RAY_EPS;
+
+                diffuse.rays.emplace_back(origin, lumina::sample_cosine_hemisphere(lumina::frame(n), rng));
+                diffuse.t_max.push_back(lumina::F32_MAX);
+
+                auto target = bounds.centroid() + lumina::vec3f32(0.0f, bounds.max.y - bounds.centroid().y, 0.0f) * 2.0f;
+                if(!lights.empty()) {
+                    const auto& light = mesh.vertex_indices[lights[std::min<lumina::usize>(lumina::uniform_1d(rng) * lights.size(), lights.size() - 1)]];
+                    auto u = lumina::uniform_2d(rng);
+                    if(u.x + u.y > 1.0f) {
+                        u = lumina::vec2f32(1.0f - u.x, 1.0f - u.y);
+                    }
+                    target = mesh.vertices[light.x] + u.x * (mesh.vertices[light.y] - mesh.vertices[light.x]) + u.y * (mesh.vertices[light.z] - mesh.vertices[light.x]);
+                }
+                auto to_target = target - origin;
+                auto distance = lumina::norm(to_target);
+                shadow.rays.emplace_back(origin, to_target / distance);
+                shadow.t_max.push_back(distance * (1.0f - 1.0e-3f));
+            }
+        }
+    }
+
+    return { std::move(primary), std::move(diffuse), std::move(shadow) };
+}
+
+template<class Accelerator>
+void measure(const char* builder, const char* name, const Accelerator& accel, lumina::f64 build_seconds, const lumina::mesh& mesh, const std::vector<ray_set>& sets, std::vector<result_row>& rows) {
+    auto nodes = accel.nodes();
+    for(const auto& set : sets) {
+        auto count = static_cast<lumina::u32>(set.rays.size());
+        auto chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+        // timed pass without counters
+        std::atomic<lumina::u64> hits{};
+        auto start = std::chrono::steady_clock::now();
+        bench::parallel_for(chunks, [&](lumina::u32, lumina::u32 chunk) {
+            lumina::u64 local_hits{};
+            for(auto i = chunk * CHUNK_SIZE; i < std::min(count, (chunk + 1) * CHUNK_SIZE); ++i) {
+                local_hits += accel.trace(mesh.vertices, mesh.vertex_indices, set.rays[i], set.t_max[i]) ? 1 : 0;
+            }
+            hits += local_hits;
+        });
+        auto seconds = bench::seconds_since(start);
+
+        // counted pass
+        std::atomic<lumina::u64> visited_nodes{};
+        std::atomic<lumina::u64> tested_triangles{};
+        bench::parallel_for(chunks, [&](lumina::u32, lumina::u32 chunk) {
+            lumina::trace_counters counters{};
+            for(auto i = chunk * CHUNK_SIZE; i < std::min(count, (chunk + 1) * CHUNK_SIZE); ++i) {
+                accel.trace(mesh.vertices, mesh.vertex_indices, set.rays[i], set.t_max[i], counters);
+            }
+            visited_nodes += counters.nodes;
+            tested_triangles += counters.triangles;
+        });
+
+        auto rays = lumina::f64(std::max<lumina::u32>(1, count));
+        rows.push_back({
+            builder, name, build_seconds, nodes.size(), nodes.size_bytes(),
+            set.name, set.rays.size(), hits.load(),
+            lumina::f64(count) / seconds / 1.0e6, lumina::f64(visited_nodes) / rays, lumina::f64(tested_triangles) / rays
+        });
+    }
+}
+
+void measure_builder(const char* builder, const lumina::bvh_options& options, lumina::mesh& mesh, const std::vector<ray_set>& sets, std::vector<result_row>& rows) {
+    auto start = std::chrono::steady_clock::now();
+    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices, options);
+    mesh.reorder_polygons(bvh.reorder());
+    auto bvh_seconds = bench::seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    lumina::wide_bvh<lumina::wide_bvh_node> wide(bvh);
+    wide.reorder();
+    auto wide_seconds = bench::seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    lumina::qbvh qbvh(bvh);
+    qbvh.reorder();
+    auto qbvh_seconds = bench::seconds_since(start);
+
+    measure(builder, "bvh", bvh, bvh_seconds, mesh, sets, rows);
+    measure(builder, "wide_bvh", wide, wide_seconds, mesh, sets, rows);
+    measure(builder, "qbvh", qbvh, qbvh_seconds, mesh, sets, rows);
+}
+
+void print_csv(const std::vector<result_row>& rows) {
+    std::cout << "builder,accelerator,build_seconds,nodes,node_bytes,ray_set,rays,hits,mrays_per_sec,nodes_per_ray,triangles_per_ray\n";
+    for(const auto& r : rows) {
+        std::cout << std::format("{},{},{:.4f},{},{},{},{},{},{:.3f},{:.2f},{:.2f}\n", r.builder, r.accelerator, r.build_seconds, r.nodes, r.node_bytes, r.ray_set, r.rays, r.hits, r.mrays_per_sec, r.nodes_per_ray, r.triangles_per_ray);
+    }
+    std::cout << std::flush;
+}
+
+// scene path is the only free string, escape what JSON requires
+std::string json_string(std::string_view s) {
+    std::string escaped = "\"";
+    for(auto c : s) {
+        if(c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+void print_json(const char* scene, const std::vector<result_row>& rows) {
+    std::cout << std::format("{{\"scene\": {}, \"results\": [\n", json_string(scene));
+    for(size_t i = 0; i < rows.size(); ++i) {
+        const auto& r = rows[i];
+        std::cout << std::format(
+            "  {{\"builder\": \"{}\", \"accelerator\": \"{}\", \"build_seconds\": {:.4f}, \"nodes\": {}, \"node_bytes\": {}, \"ray_set\": \"{}\", \"rays\": {}, \"hits\": {}, \"mrays_per_sec\": {:.3f}, \"nodes_per_ray\": {:.2f}, \"triangles_per_ray\": {:.2f}}}{}\n",
+            r.builder, r.accelerator, r.build_seconds, r.nodes, r.node_bytes, r.ray_set, r.rays, r.hits, r.mrays_per_sec, r.nodes_per_ray, r.triangles_per_ray, i + 1 < rows.size() ? "," : ""
+        );
+    }
+    std::cout << "]}" << std::endl;
+}
+
+int main(int argc, const char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : bench::DEFAULT_SCENE;
+    lumina::u32 spp = argc > 2 ? std::stoul(argv[2]) : 4;
+    std::string_view format = argc > 3 ? argv[3] : "csv";
+    if(format != "csv" && format != "json") {
+        std::clog << std::format("unknown output format: {} (csv or json). exit.", format) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto mesh = bench::load_mori_knob(path);
+    auto cam = bench::mori_knob_camera(IMAGE_WIDTH, IMAGE_HEIGHT);
+    auto sets = generate_ray_sets(mesh, cam, spp);
+
+    std::vector<result_row> rows{};
+    measure_builder("median", {.split = lumina::bvh_split::median}, mesh, sets, rows);
+    measure_builder("sah", {.split = lumina::bvh_split::sah}, mesh, sets, rows);
+    measure_builder("sbvh", {.split = lumina::bvh_split::spatial}, mesh, sets, rows);
+
+    if(format == "json") {
+        print_json(path, rows);
+    }
+    else {
+        print_csv(rows);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+
+#include "frame.hpp"
+#include "material.hpp"
+#include "microfacet.hpp"
+#include "ref_idx.hpp"
+
+namespace lumina {
+
+struct bsdf_sample {
+    vec3f32 omega_i;
+    // f * |cos_i| / pdf
+    vec3f32 weight;
+    f32 pdf;
+};
+
+// quantity carried along the sampled direction
+// radiance: camera paths, importance: light / photon paths (adjoint bsdf)
+// refraction compresses radiance by 1 / eta^2, the adjoint bsdf has no such factor
+// reference: Eric Veach - "Robust Monte Carlo Methods for Light Transport Simulation", 1997, chapter 5
+enum class transport_mode {
+    radiance,
+    importance,
+};
+
+// scattering function at a shading point
+// every direction is in world space and points away from the surface
+// the shading frame normal has to face omega_o (side of the incoming ray)
+class bsdf {
+    frame frame_;
+    material_type type_;
+    vec3f32 albedo_;
+    f32 roughness_;
+    f32 alpha_;
+    // relative index of refraction (behind the surface / in front of the surface)
+    f32 eta_;
+    transport_mode mode_;
+
+    // factor of refracted light on top of the btdf for radiance (1 / eta^2)
+    f32 transmission_scale_() const noexcept {
+        return mode_ == transport_mode::radiance ? 1.0f : eta_ * eta_;
+    }
+
+    // Schlick's approximation with F0 = albedo
+    vec3f32 f_conductor_(f32 cos_h) const {
+        auto c = 1.0f - std::clamp(cos_h, 0.0f, 1.0f);
+        auto c2 = c * c;
+        return albedo_ + (vec3f32(1.0f) - albedo_) * (c2 * c2 * c);
+    }
+
+public:
+    // entering: omega_o is on the outside of the surface (front face)
+    bsdf(const material& mat, const frame& shading, bool entering, transport_mode mode = transport_mode::radiance) noexcept :
+        frame_(shading),
+        type_(mat.type),
+        albedo_(mat.albedo),
+        roughness_(mat.roughness),
+        alpha_(ggx_alpha(mat.roughness)),
+        eta_(1.0f),
+        mode_(mode)
+    {
+        if(mat.refractive_index > 0.0f) {
+            eta_ = entering ? mat.refractive_index / ref_idx::AIR : ref_idx::AIR / mat.refractive_index;
+        }
+    }
+
+    const frame& shading_frame() const noexcept { return frame_; }
+
+    vec3f32 eval(const vec3f32& omega_o, const vec3f32& omega_i) const {
+        const auto& n = frame_.n;
+        auto cos_o = dot(omega_o, n);
+        auto cos_i = dot(omega_i, n);
+
+        switch(type_) {
+            case material_type::diffuse:
+                if(cos_o <= 0.0f || cos_i <= 0.0f) {
+                    return {};
+                }
+                return albedo_ / F32_PI;
+
+            case material_type::conductor: {
+                if(cos_o <= 0.0f || cos_i <= 0.0f) {
+                    return {};
+                }
+                auto h = normalize(omega_i + omega_o);
+                return f_conductor_(dot(omega_o, h)) * (d(h, n, alpha_) * g2(omega_i, omega_o, h, n, alpha_) / (4.0f * cos_o * cos_i));
+            }
+
+            case material_type::dielectric:
+                if(cos_i > 0.0f) {
+                    return vec3f32(brdf_mf(omega_i, omega_o, n, eta_, alpha_));
+                }
+                return albedo_ * (btdf_mf(omega_i, omega_o, n, eta_, alpha_) * transmission_scale_());
+        }
+
+        return {};
+    }
+
+    f32 pdf(const vec3f32& omega_o, const vec3f32& omega_i) const {
+        const auto& n = frame_.n;
+        auto cos_o = dot(omega_o, n);
+        auto cos_i = dot(omega_i, n);
+        if(cos_o <= 0.0f) {
+            return 0.0f;
+        }
+
+        switch(type_) {
+            case material_type::diffuse:
+                return cos_i > 0.0f ? cos_i / F32_PI : 0.0f;
+
+            case material_type::conductor: {
+                if(cos_i <= 0.0f) {
+                    return 0.0f;
+                }
+                auto h = normalize(omega_i + omega_o);
+                return d_visible(omega_o, h, n, alpha_) / (4.0f * dot(omega_o, h));
+            }
+
+            case material_type::dielectric: {
+                // reflection
+                if(cos_i > 0.0f) {
+                    auto h = normalize(omega_i + omega_o);
+                    return f(omega_o, h, 1.0f, eta_) * d_visible(omega_o, h, n, alpha_) / (4.0f * dot(omega_o, h));
+                }
+                // refraction
+                auto h = half_vector_t(omega_i, omega_o, n, eta_);
+                auto i_h = dot(omega_i, h);
+                auto o_h = dot(omega_o, h);
+                if(i_h >= 0.0f || o_h <= 0.0f) {
+                    return 0.0f;
+                }
+                auto denominator = i_h + o_h / eta_;
+                auto dh_di = std::abs(i_h) / (denominator * denominator);
+                return (1.0f - f(omega_o, h, 1.0f, eta_)) * d_visible(omega_o, h, n, alpha_) * dh_di;
+            }
+        }
+
+        return 0.0f;
+    }
+
+    // the weights are computed from the sampled microfacet normal, so D cancels out analytically
+    // and nearly specular surfaces (alpha -> GGX_MIN_ALPHA) stay stable
+    template<class RandGen>
+    std::optional<bsdf_sample> sample(const vec3f32& omega_o, RandGen& rng) const {
+        const auto& n = frame_.n;
+        if(dot(omega_o, n) <= 0.0f) {
+            return std::nullopt;
+        }
+
+        if(type_ == material_type::diffuse) {
+            auto omega_i = sample_cosine_hemisphere(frame_, rng);
+            auto cos_i = dot(omega_i, n);
+            if(cos_i <= 0.0f) {
+                return std::nullopt;
+            }
+            return bsdf_sample{ omega_i, albedo_, cos_i / F32_PI };
+        }
+
+        auto [m, omega_r, pdf_r] = sample_ggx(omega_o, frame_, roughness_, rng);
+        auto g1_o = g1(omega_o, m, n, alpha_);
+        if(g1_o <= 0.0f) {
+            return std::nullopt;
+        }
+
+        if(type_ == material_type::conductor) {
+            if(dot(omega_r, n) <= 0.0f) {
+                return std::nullopt;
+            }
+            // f * cos_i / pdf = F * G2 / G1(o)
+            auto weight = f_conductor_(dot(omega_o, m)) * (g2(omega_r, omega_o, m, n, alpha_) / g1_o);
+            return bsdf_sample{ omega_r, weight, pdf_r };
+        }
+
+        // dielectric -> choose reflection or refraction by Fresnel reflectance
+        auto fr = f(omega_o, m, 1.0f, eta_);
+        if(uniform_1d(rng) < fr) {
+            if(dot(omega_r, n) <= 0.0f) {
+                return std::nullopt;
+            }
+            auto weight = vec3f32(g2(omega_r, omega_o, m, n, alpha_) / g1_o);
+            return bsdf_sample{ omega_r, weight, fr * pdf_r };
+        }
+
+        auto omega_t = refract(-omega_o, m, 1.0f, eta_);
+        if(!omega_t || dot(*omega_t, n) >= 0.0f) {
+            return std::nullopt;
+        }
+        auto weight = albedo_ * (g2(*omega_t, omega_o, m, n, alpha_) / (g1_o * eta_ * eta_) * transmission_scale_());
+        return bsdf_sample{ *omega_t, weight, pdf(omega_o, *omega_t) };
+    }
+};
+
+}
\ No newline at end of file
@@ -1,8 +1,218 @@
+#include <array>
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <tuple>
+
 #include "bvh.hpp"
 
 namespace lumina {
 
-bvh::bvh(const std::vector<vec3f32>& vertices, const std::vector<vec3u32>& indices) {
+namespace internal_ {
+
+constexpr u32 SAH_BINS_ = 32;
+constexpr f64 SAH_TRAVERSAL_COST_ = 1.0;
+constexpr f64 SAH_INTERSECTION_COST_ = 1.0;
+
+// (part of) polygon in a node
+struct bvh_reference_ {
+    aabb box;
+    u32 index;
+};
+
+struct sah_bin_ {
+    aabb box{};
+    // references whose box starts / ends in this bin (spatial) or whose centroid is in this bin (object)
+    u32 entries{};
+    u32 exits{};
+};
+
+// candidate split of a node, cost = sum of area * references over both children
+struct sah_split_ {
+    f64 cost = std::numeric_limits<f64>::infinity();
+    u32 axis{};
+    // object: centroids in bins up to bin go left, bins span [min, min + extent]
+    u32 bin{};
+    f32 min{};
+    f32 extent{};
+    // spatial: split plane
+    f32 position{};
+    // estimated children
+    aabb left{};
+    aabb right{};
+    u32 left_count{};
+    u32 right_count{};
+
+    bool is_valid() const noexcept { return cost < std::numeric_limits<f64>::infinity(); }
+};
+
+inline aabb overlap_(const aabb& a, const aabb& b) noexcept {
+    return { max(a.min, b.min), min(a.max, b.max) };
+}
+
+inline u32 bin_of_(f32 x, f32 min, f32 extent) noexcept {
+    auto bin = static_cast<s32>((x - min) / extent * f32(SAH_BINS_));
+    return static_cast<u32>(std::clamp<s32>(bin, 0, SAH_BINS_ - 1));
+}
+
+// clips triangle (within box) at plane axis = position, invalid box for an empty side
+inline std::pair<aabb, aabb> split_reference_(const triangle& tri, const aabb& box, u32 axis, f32 position) noexcept {
+    aabb left{};
+    aabb right{};
+    std::array<vec3f32, 3> p = {tri.p0, tri.p1, tri.p2};
+    for(u32 k = 0; k < 3; ++k) {
+        const auto& a = p[k];
+        const auto& b = p[(k + 1) % 3];
+        if(a[axis] <= position) {
+            left += aabb(a, a);
+        }
+        if(a[axis] >= position) {
+            right += aabb(a, a);
+        }
+        // edge crosses the plane
+        if((a[axis] < position && position < b[axis]) || (b[axis] < position && position < a[axis])) {
+            auto q = a + (b - a) * ((position - a[axis]) / (b[axis] - a[axis]));
+            q[axis] = position;
+            left += aabb(q, q);
+            right += aabb(q, q);
+        }
+    }
+    left.max[axis] = std::min(left.max[axis], position);
+    right.min[axis] = std::max(right.min[axis], position);
+    return { overlap_(left, box), overlap_(right, box) };
+}
+
+// internal nodes of a balanced subtree over count references (one reference per leaf)
+inline u32 balanced_depth_(usize count) noexcept {
+    return static_cast<u32>(std::bit_width(std::max<usize>(count, 1) - 1));
+}
+
+inline triangle triangle_of_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, u32 index) noexcept {
+    return { vertices[indices[index].x], vertices[indices[index].y], vertices[indices[index].z] };
+}
+
+// sweeps bins of one axis and keeps the cheapest plane in best
+// left counts are taken from entries, right counts from exits (same for object bins)
+template<class Record>
+void sweep_bins_(const std::array<sah_bin_, SAH_BINS_>& bins, sah_split_& best, Record record) {
+    std::array<aabb, SAH_BINS_> right_boxes{};
+    std::array<u32, SAH_BINS_> right_counts{};
+    aabb right{};
+    u32 right_count{};
+    for(u32 i = SAH_BINS_ - 1; i > 0; --i) {
+        right += bins[i].box;
+        right_count += bins[i].exits;
+        right_boxes[i] = right;
+        right_counts[i] = right_count;
+    }
+
+    aabb left{};
+    u32 left_count{};
+    for(u32 i = 0; i + 1 < SAH_BINS_; ++i) {
+        left += bins[i].box;
+        left_count += bins[i].entries;
+        if(left_count == 0 || right_counts[i + 1] == 0) {
+            continue;
+        }
+        auto cost = f64(left.area()) * left_count + f64(right_boxes[i + 1].area()) * right_counts[i + 1];
+        if(cost < best.cost) {
+            best.cost = cost;
+            best.left = left;
+            best.right = right_boxes[i + 1];
+            best.left_count = left_count;
+            best.right_count = right_counts[i + 1];
+            record(i);
+        }
+    }
+}
+
+// binned by centroid
+inline sah_split_ find_object_split_(std::span<const bvh_reference_> refs) {
+    aabb centroids{};
+    for(const auto& ref : refs) {
+        auto c = ref.box.centroid();
+        centroids += aabb(c, c);
+    }
+
+    sah_split_ best{};
+    for(u32 axis = 0; axis < 3; ++axis) {
+        auto extent = centroids.max[axis] - centroids.min[axis];
+        if(extent <= 0.0f) {
+            continue;
+        }
+
+        std::array<sah_bin_, SAH_BINS_> bins{};
+        for(const auto& ref : refs) {
+            auto& bin = bins[bin_of_(ref.box.centroid()[axis], centroids.min[axis], extent)];
+            bin.box += ref.box;
+            ++bin.entries;
+            ++bin.exits;
+        }
+
+        sweep_bins_(bins, best, [&](u32 i) {
+            best.axis = axis;
+            best.bin = i;
+            best.min = centroids.min[axis];
+            best.extent = extent;
+        });
+    }
+    return best;
+}
+
+// binned by chopping references at every bin plane they cross
+inline sah_split_ find_spatial_split_(std::span<const bvh_reference_> refs, const aabb& node_box, std::span<const vec3f32> vertices, std::span<const vec3u32> indices) {
+    sah_split_ best{};
+    for(u32 axis = 0; axis < 3; ++axis) {
+        auto extent = node_box.max[axis] - node_box.min[axis];
+        if(extent <= 0.0f) {
+            continue;
+        }
+        auto plane = [&](u32 i) { return node_box.min[axis] + extent * f32(i) / f32(SAH_BINS_); };
+
+        std::array<sah_bin_, SAH_BINS_> bins{};
+        for(const auto& ref : refs) {
+            auto first = bin_of_(ref.box.min[axis], node_box.min[axis], extent);
+            auto last = bin_of_(ref.box.max[axis], node_box.min[axis], extent);
+            ++bins[first].entries;
+            ++bins[last].exits;
+
+            auto tri = triangle_of_(vertices, indices, ref.index);
+            auto rest = ref.box;
+            for(auto i = first; i < last; ++i) {
+                auto [left, right] = split_reference_(tri, rest, axis, plane(i + 1));
+                if(left) {
+                    bins[i].box += left;
+                }
+                if(!right) {
+                    break;
+                }
+                rest = right;
+            }
+            bins[last].box += rest;
+        }
+
+        sweep_bins_(bins, best, [&](u32 i) {
+            best.axis = axis;
+            best.position = plane(i + 1);
+        });
+    }
+    return best;
+}
+
+}
+
+bvh::bvh(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const bvh_options& options) :
+    polygon_count_(static_cast<u32>(indices.size()))
+{
+    if(options.split == bvh_split::median) {
+        build_median_(vertices, indices);
+    }
+    else {
+        build_sah_(vertices, indices, options);
+    }
+}
+
+void bvh::build_median_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices) {
     std::vector<u32> index_indices(indices.size());
     std::iota(index_indices.begin(), index_indices.end(), 0);
 
@@ -61,54 +271,309 @@ bvh::bvh(const std::vector<vec3f32>& vertices, const std::vector<vec3u32>& indic
     }
 }
 
-std::optional<std::pair<u32, f32>> bvh::trace(const std::vector<vec3f32>& vertices, const std::vector<vec3u32>& indices, const ray& r, f32 t_max) const {
-    std::queue<s32> idxs{};
+void bvh::build_sah_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const bvh_options& options) {
+    std::vector<internal_::bvh_reference_> refs(indices.size());
+    aabb root_box{};
+    for(u32 i = 0; i < indices.size(); ++i) {
+        refs[i] = { aabb(internal_::triangle_of_(vertices, indices, i)), i };
+        root_box += refs[i].box;
+    }
+    auto min_overlap = f64(root_box.area()) * options.alpha;
+    auto max_depth = std::max(std::min(options.max_depth, BVH_MAX_DEPTH), internal_::balanced_depth_(refs.size()));
 
-    idxs.push(0);
+    // (references, node index, depth of node)
+    std::queue<std::tuple<std::vector<internal_::bvh_reference_>, u32, u32>> build_queue{};
+    build_queue.push({std::move(refs), 0, 0});
 
-    f32 t = t_max;
-    u32 i = U32_MAX;
+    nodes_.push_back({});
 
-    u32 count{};
+    while(!build_queue.empty()) {
+        auto [node_refs, node_idx, depth] = std::move(build_queue.front());
+        build_queue.pop();
 
-    while(!idxs.empty()) {
-        auto current_idx = idxs.front();
-        idxs.pop();
+        std::vector<internal_::bvh_reference_> left_refs{};
+        std::vector<internal_::bvh_reference_> right_refs{};
 
-        if(intersect(r, nodes_[current_idx].left_box)) {
-            // internal
-            if(nodes_[current_idx].left_index > 0) {
-                idxs.push(nodes_[current_idx].left_index);
+        // no depth left for an unbalanced split -> halves at the centroid median of the widest axis
+        // every child keeps depth + balanced_depth_(count) <= max_depth, so the subtree closes within the limit
+        if(depth + internal_::balanced_depth_(node_refs.size()) >= max_depth) {
+            aabb centroids{};
+            for(const auto& ref : node_refs) {
+                auto c = ref.box.centroid();
+                centroids += aabb(c, c);
             }
-            // leaf
-            else {
-                auto tri_idx = -nodes_[current_idx].left_index;
-                auto curr_t = intersect(r, {vertices[indices[tri_idx].x], vertices[indices[tri_idx].y], vertices[indices[tri_idx].z]});
-                if(curr_t) {
-                    if(*curr_t < t) {
-                        t = *curr_t;
-                        i = tri_idx;
+            auto extent = centroids.max - centroids.min;
+            auto axis = extent.x > extent.y ? (extent.x > extent.z ? 0u : 2u) : (extent.y > extent.z ? 1u : 2u);
+
+            auto middle = node_refs.begin() + node_refs.size() / 2;
+            std::nth_element(node_refs.begin(), middle, node_refs.end(), [&](const auto& a, const auto& b) {
+                return a.box.centroid()[axis] < b.box.centroid()[axis];
+            });
+            left_refs.assign(node_refs.begin(), middle);
+            right_refs.assign(middle, node_refs.end());
+        }
+        else {
+            auto object_split = internal_::find_object_split_(node_refs);
+
+            // spatial split only where object split children overlap
+            auto spatial = false;
+            if(options.split == bvh_split::spatial && object_split.is_valid()) {
+                auto overlap = internal_::overlap_(object_split.left, object_split.right);
+                if(overlap && overlap.area() > min_overlap) {
+                    aabb node_box{};
+                    for(const auto& ref : node_refs) {
+                        node_box += ref.box;
+                    }
+
+                    auto split = internal_::find_spatial_split_(node_refs, node_box, vertices, indices);
+                    if(split.cost < object_split.cost) {
+                        auto axis = split.axis;
+                        auto position = split.position;
+                        for(const auto& ref : node_refs) {
+                            if(ref.box.max[axis] <= position) {
+                                left_refs.push_back(ref);
+                            }
+                            else if(ref.box.min[axis] >= position) {
+                                right_refs.push_back(ref);
+                            }
+                            else {
+                                // reference unsplitting, keep the whole reference on one side if that is cheaper
+                                // every reference is judged against the split as found, so the result does not depend on the order of references
+                                // (a mesh written in leaf order builds the same tree again, see mesh::reorder_polygons())
+                                auto split_cost = f64(split.left.area()) * split.left_count + f64(split.right.area()) * split.right_count;
+                                auto left_cost = f64((split.left + ref.box).area()) * split.left_count + f64(split.right.area()) * (f64(split.right_count) - 1.0);
+                                auto right_cost = f64(split.left.area()) * (f64(split.left_count) - 1.0) + f64((split.right + ref.box).area()) * split.right_count;
+
+                                if(left_cost < split_cost && left_cost <= right_cost) {
+                                    left_refs.push_back(ref);
+                                }
+                                else if(right_cost < split_cost) {
+                                    right_refs.push_back(ref);
+                                }
+                                else {
+                                    auto [left, right] = internal_::split_reference_(internal_::triangle_of_(vertices, indices, ref.index), ref.box, axis, position);
+                                    if(left) {
+                                        left_refs.push_back({left, ref.index});
+                                    }
+                                    if(right) {
+                                        right_refs.push_back({right, ref.index});
+                                    }
+                                    if(!left && !right) {
+                                        left_refs.push_back(ref);
+                                    }
+                                }
+                            }
+                        }
+
+                        // both children have to shrink, otherwise fall back to object split
+                        spatial = !left_refs.empty() && !right_refs.empty() && left_refs.size() < node_refs.size() && right_refs.size() < node_refs.size();
+                        if(spatial) {
+                            ++spatial_split_count_;
+                        }
+                        else {
+                            left_refs.clear();
+                            right_refs.clear();
+                        }
                     }
                 }
             }
+
+            if(!spatial) {
+                if(object_split.is_valid()) {
+                    for(const auto& ref : node_refs) {
+                        auto bin = internal_::bin_of_(ref.box.centroid()[object_split.axis], object_split.min, object_split.extent);
+                        (bin <= object_split.bin ? left_refs : right_refs).push_back(ref);
+                    }
+                }
+                // all centroids at one point -> halves
+                else {
+                    auto middle = node_refs.begin() + node_refs.size() / 2;
+                    left_refs.assign(node_refs.begin(), middle);
+                    right_refs.assign(middle, node_refs.end());
+                }
+            }
+        }
+
+        aabb left_box{};
+        aabb right_box{};
+        for(const auto& ref : left_refs) {
+            left_box += ref.box;
+        }
+        for(const auto& ref : right_refs) {
+            right_box += ref.box;
         }
-        if(intersect(r, nodes_[current_idx].right_box)) {
-            // internal
-            if(nodes_[current_idx].right_index > 0) {
-                idxs.push(nodes_[current_idx].right_index);
+
+        nodes_[node_idx].left_box  = left_box;
+        nodes_[node_idx].right_box = right_box;
+
+        if(left_refs.size() == 1) {
+            nodes_[node_idx].left_index = -static_cast<s32>(left_refs[0].index);
+        }
+        else {
+            auto left_node_idx = s32(nodes_.size());
+            nodes_[node_idx].left_index = left_node_idx;
+            build_queue.push({std::move(left_refs), left_node_idx, depth + 1});
+            nodes_.push_back({});
+        }
+        if(right_refs.size() == 1) {
+            nodes_[node_idx].right_index = -static_cast<s32>(right_refs[0].index);
+        }
+        else {
+            auto right_node_idx = s32(nodes_.size());
+            nodes_[node_idx].right_index = right_node_idx;
+            build_queue.push({std::move(right_refs), right_node_idx, depth + 1});
+            nodes_.push_back({});
+        }
+    }
+}
+
+f64 bvh::sah_cost() const noexcept {
+    if(nodes_.empty()) {
+        return 0.0;
+    }
+
+    auto root_area = f64((nodes_[0].left_box + nodes_[0].right_box).area());
+    if(root_area <= 0.0) {
+        return 0.0;
+    }
+
+    f64 cost{};
+    for(const auto& node : nodes_) {
+        cost += internal_::SAH_TRAVERSAL_COST_ * f64((node.left_box + node.right_box).area()) / root_area;
+        if(node.left_index <= 0) {
+            cost += internal_::SAH_INTERSECTION_COST_ * f64(node.left_box.area()) / root_area;
+        }
+        if(node.right_index <= 0) {
+            cost += internal_::SAH_INTERSECTION_COST_ * f64(node.right_box.area()) / root_area;
+        }
+    }
+    return cost;
+}
+
+void bvh::statistics() const {
+    auto duplicated = references() - std::min(references(), polygon_count_);
+    std::cout << std::format("# of bvh nodes: {}, # of references: {} ({} duplicated, {:.1f}%), # of spatial splits: {}\n", nodes_.size(), references(), duplicated, 100.0 * f64(duplicated) / f64(std::max<u32>(1, polygon_count_)), spatial_split_count_);
+    std::cout << std::format("sah cost: {:.2f}\n", sah_cost());
+    std::cout << std::flush;
+}
+
+std::vector<u32> bvh::reorder() {
+    // pass 1: depth first visiting order of nodes and leaves, the child with the larger box first
+    // left / right slots are kept, only positions in memory change
+    std::vector<s32> new_node_index(nodes_.size());
+    std::vector<u32> order{};
+    // polygons referenced by several leaves (spatial splits) take the position of their first leaf
+    std::vector<s32> new_leaf_index(polygon_count_, -1);
+    s32 node_count{};
+
+    // (is node, index)
+    std::vector<std::pair<bool, s32>> stack{{true, 0}};
+    while(!stack.empty()) {
+        auto [is_node, index] = stack.back();
+        stack.pop_back();
+
+        if(!is_node) {
+            if(new_leaf_index[-index] < 0) {
+                new_leaf_index[-index] = static_cast<s32>(order.size());
+                order.push_back(static_cast<u32>(-index));
+            }
+            continue;
+        }
+
+        new_node_index[index] = node_count++;
+        const auto& node = nodes_[index];
+        auto larger = node.left_index;
+        auto smaller = node.right_index;
+        if(node.right_box.area() > node.left_box.area()) {
+            std::swap(larger, smaller);
+        }
+        stack.push_back({smaller > 0, smaller});
+        stack.push_back({larger > 0, larger});
+    }
+
+    // pass 2: rewrite nodes with new indices
+    auto remap = [&](s32 index) { return index > 0 ? new_node_index[index] : -new_leaf_index[-index]; };
+    std::vector<bvh_node> nodes(nodes_.size());
+    for(size_t i = 0; i < nodes_.size(); ++i) {
+        const auto& node = nodes_[i];
+        nodes[new_node_index[i]] = { node.left_box, node.right_box, remap(node.left_index), remap(node.right_index) };
+    }
+    nodes_ = std::move(nodes);
+
+    return order;
+}
+
+std::optional<std::pair<u32, f32>> bvh::trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max) const {
+    return trace_<false>(vertices, indices, r, t_max, nullptr);
+}
+
+std::optional<std::pair<u32, f32>> bvh::trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters& counters) const {
+    return trace_<true>(vertices, indices, r, t_max, &counters);
+}
+
+template<bool Count>
+std::optional<std::pair<u32, f32>> bvh::trace_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters* counters) const {
+    auto inv_direction = vec3f32(1.0f / r.direction.x, 1.0f / r.direction.y, 1.0f / r.direction.z);
+
+    // depth first, near child first, nodes entered beyond the closest hit are culled
+    // entries: node index, distance at which the ray enters its box
+    std::array<std::pair<s32, f32>, internal_::BVH_STACK_SIZE_> stack{};
+    u32 top{};
+    stack[top++] = {0, 0.0f};
+
+    f32 t = t_max;
+    u32 i = U32_MAX;
+
+    auto hit_polygon = [&](s32 child) {
+        auto tri_idx = static_cast<u32>(-child);
+        if constexpr(Count) {
+            ++counters->triangles;
+        }
+        auto curr_t = intersect(r, {vertices[indices[tri_idx].x], vertices[indices[tri_idx].y], vertices[indices[tri_idx].z]});
+        if(curr_t && *curr_t < t) {
+            t = *curr_t;
+            i = tri_idx;
+        }
+    };
+
+    while(top > 0) {
+        auto [current_idx, entry] = stack[--top];
+        if(entry > t) {
+            continue;
+        }
+        const auto& node = nodes_[current_idx];
+        if constexpr(Count) {
+            ++counters->nodes;
+            counters->boxes += 2;
+        }
+
+        auto near = node.left_index;
+        auto far = node.right_index;
+        auto near_t = internal_::enter_box_(r, inv_direction, node.left_box, t);
+        auto far_t = internal_::enter_box_(r, inv_direction, node.right_box, t);
+        if(far_t && (!near_t || *far_t < *near_t)) {
+            std::swap(near, far);
+            std::swap(near_t, far_t);
+        }
+
+        // leaves are intersected at once, the near polygon first so it can cull the far child
+        if(near_t && near <= 0) {
+            hit_polygon(near);
+        }
+        if(far_t && *far_t <= t) {
+            if(far > 0) {
+                assert(top < stack.size());
+                stack[top++] = {far, *far_t};
             }
-            // leaf
             else {
-                auto tri_idx = -nodes_[current_idx].right_index;
-                auto curr_t = intersect(r, {vertices[indices[tri_idx].x], vertices[indices[tri_idx].y], vertices[indices[tri_idx].z]});
-                if(curr_t) {
-                    if(*curr_t < t) {
-                        t = *curr_t;
-                        i = tri_idx;
-                    }
-                }
+                hit_polygon(far);
             }
         }
+        // pushed last, popped next
+        if(near_t && near > 0) {
+            assert(top < stack.size());
+            stack[top++] = {near, *near_t};
+        }
     }
 
     if(i == U32_MAX) {
@@ -1,13 +1,18 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <iostream>
 #include <numeric>
+#include <optional>
 #include <queue>
+#include <span>
 #include <vector>
 
 #include "aabb.hpp"
 #include "ray.hpp"
 #include "intersect.hpp"
+#include "statistics.hpp"
 
 namespace lumina {
 
@@ -25,13 +30,87 @@ inline std::ostream& operator<<(std::ostream& os, const bvh_node& bn) {
     return os;
 }
 
+enum class bvh_split {
+    // median of centroids, axes in turn
+    median,
+    // binned surface area heuristic
+    sah,
+    // sah with spatial splits (sbvh), polygons may be referenced by several leaves with clipped bounds
+    // reference: Stich et al. - "Spatial Splits in Bounding Volume Hierarchies", 2009
+    spatial
+};
+
+// most internal nodes on a path from the root to a leaf, bounds the traversal stacks of bvh and wide_bvh
+constexpr u32 BVH_MAX_DEPTH = 64;
+
+struct bvh_options {
+    bvh_split split = bvh_split::median;
+    // most internal nodes on a path from the root to a leaf (bvh_split::sah / bvh_split::spatial), at most BVH_MAX_DEPTH
+    // leaves hold one polygon, so a node that would otherwise exceed the limit is split into halves (balanced subtree) without spatial splits
+    // at least ceil(log2(polygon count)) is used, which the median build reaches anyway
+    u32 max_depth = BVH_MAX_DEPTH;
+    // spatial splits are tried only where the children of the best object split overlap more than alpha * root area
+    // memory budget of bvh_split::spatial: 1 -> no spatial split, 0 -> unlimited duplication
+    f32 alpha = 1.0e-5f;
+};
+
+namespace internal_ {
+
+// distance at which the ray enters the box, clamped to [0, t_max], nullopt if it misses the box within t_max
+inline std::optional<f32> enter_box_(const ray& r, const vec3f32& inv_direction, const aabb& b, f32 t_max) noexcept {
+    f32 t_min = 0.0f;
+    for(u32 i = 0; i < 3; ++i) {
+        auto t0 = (b.min[i] - r.origin[i]) * inv_direction[i];
+        auto t1 = (b.max[i] - r.origin[i]) * inv_direction[i];
+        t_min = std::max(t_min, std::min(t0, t1));
+        t_max = std::min(t_max, std::max(t0, t1));
+    }
+    if(t_min > t_max) {
+        return std::nullopt;
+    }
+    return t_min;
+}
+
+// near child first traversal keeps at most one far sibling per level above the current node
+constexpr usize BVH_STACK_SIZE_ = BVH_MAX_DEPTH + 1;
+
+}
+
 class bvh {
     std::vector<bvh_node> nodes_;
+    u32 polygon_count_{};
+    u32 spatial_split_count_{};
+
+    void build_median_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices);
+    void build_sah_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const bvh_options& options);
+
+    // counters == nullptr for Count == false
+    template<bool Count>
+    std::optional<std::pair<u32, f32>> trace_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters* counters) const;
 
 public:
-    bvh(const std::vector<vec3f32>& vertices, const std::vector<vec3u32>& indices);
+    bvh(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const bvh_options& options = {});
+
+    std::optional<std::pair<u32, f32>> trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max) const;
+    // same as trace(), adds the work of this call to counters
+    std::optional<std::pair<u32, f32>> trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters& counters) const;
+
+    // lays nodes out depth first, the child with the larger box directly after its parent
+    // leaves are renumbered in the same order, returns the polygon order to apply to mesh: order[new index] = old index
+    // e.g. mesh.reorder_polygons(bvh.reorder());
+    std::vector<u32> reorder();
+
+    // child boxes of leaf slots are the bounds of their polygons (clipped parts of them with spatial splits)
+    std::span<const bvh_node> nodes() const noexcept { return nodes_; }
+
+    // leaves, polygon count + duplicated references of spatial splits
+    u32 references() const noexcept { return static_cast<u32>(nodes_.size()) + 1; }
+
+    // expected cost of a random ray relative to the root box: sum of (area / root area) * cost over nodes and leaves
+    // reference: MacDonald and Booth - "Heuristics for ray tracing using space subdivision", 1990
+    f64 sah_cost() const noexcept;
 
-    std::optional<std::pair<u32, f32>> trace(const std::vector<vec3f32>& vertices, const std::vector<vec3u32>& indices, const ray& r, f32 t_max) const;
+    void statistics() const;
 };
 
 }
@@ -4,6 +4,7 @@
 
 #include "vector.hpp"
 #include "ray.hpp"
+#include "sampler.hpp"
 
 namespace lumina {
 
@@ -46,28 +47,33 @@ public:
         first_pixel_ = vp_upper_left + 0.5f * (du_ + dv_);
     }
 
-    ray generate_ray(u32 i, u32 j) {
+    ray generate_ray(u32 i, u32 j) const {
         auto origin = first_pixel_ + (f32(i) * du_) + (f32(j) * dv_);
         auto direction = normalize(origin - from);
 
         return {origin, direction};
     }
 
-    // for multi-sampling
-    template<class RandGen>
-    ray generate_ray(u32 i, u32 j, RandGen& rng) {
-        f32 offset_x{};
-        f32 offset_y{};
-        std::uniform_real_distribution<f32> offset(-0.5f, 0.5f);
-        // std::uniform_real_distribution<f32> offset(-1.5f, 1.5f);
-        offset_x = offset(rng);
-        offset_y = offset(rng);
-
-        auto origin = first_pixel_ + ((f32(i) + offset_x) * du_) + ((f32(j) + offset_y) * dv_);
+    // continuous film position, center of pixel (i, j) is (i, j)
+    ray generate_ray(const vec2f32& position) const {
+        auto origin = first_pixel_ + (position.x * du_) + (position.y * dv_);
         auto direction = normalize(origin - from);
 
         return {origin, direction};
     }
+
+    // uniform position in pixel (i, j)
+    template<class RandGen>
+    static vec2f32 sample_position(u32 i, u32 j, RandGen& rng) {
+        auto u = uniform_2d(rng);
+        return { f32(i) + u.x - 0.5f, f32(j) + u.y - 0.5f };
+    }
+
+    // for multi-sampling (box filter over the pixel)
+    template<class RandGen>
+    ray generate_ray(u32 i, u32 j, RandGen& rng) const {
+        return generate_ray(sample_position(i, j, rng));
+    }
 };
 
 inline std::ostream& operator<<(std::ostream& os, const camera& c) {
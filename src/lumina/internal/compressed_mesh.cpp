@@ -0,0 +1,219 @@
+#include <cassert>
+#include <cmath>
+
+#include "compressed_mesh.hpp"
+#include "octahedral.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+constexpr f32 U16_SCALE_ = 65535.0f;
+
+inline u16 quantize_(f32 x, f32 min, f32 max) noexcept {
+    if(max <= min) {
+        return 0;
+    }
+    auto q = std::round((x - min) / (max - min) * U16_SCALE_);
+    return static_cast<u16>(std::clamp(q, 0.0f, U16_SCALE_));
+}
+
+inline f32 dequantize_(u16 q, f32 min, f32 max) noexcept {
+    // q == 65535 -> max exactly
+    auto s = f32(q) / U16_SCALE_;
+    return min * (1.0f - s) + max * s;
+}
+
+}
+
+compressed_mesh::compressed_mesh(const mesh& mesh, const bvh& bvh) :
+    positions_(mesh.vertices.size()),
+    group_indices_(mesh.group_indices.begin(), mesh.group_indices.end())
+{
+    const auto& vertices = mesh.vertices;
+    const auto& indices = mesh.vertex_indices;
+
+    // positions relative to the bounds of their vertex block
+    for(usize first = 0; first < vertices.size(); first += VERTEX_BLOCK_SIZE_) {
+        auto last = std::min<usize>(first + VERTEX_BLOCK_SIZE_, vertices.size());
+
+        aabb box{};
+        for(auto v = first; v < last; ++v) {
+            box += aabb(vertices[v], vertices[v]);
+        }
+        vertex_blocks_.push_back(box);
+
+        for(auto v = first; v < last; ++v) {
+            for(u32 axis = 0; axis < 3; ++axis) {
+                positions_[v][axis] = internal_::quantize_(vertices[v][axis], box.min[axis], box.max[axis]);
+            }
+        }
+    }
+
+    // index blocks
+    for(usize first = 0; first < indices.size(); first += INDEX_BLOCK_SIZE_) {
+        auto last = std::min<usize>(first + INDEX_BLOCK_SIZE_, indices.size());
+
+        auto base = U32_MAX;
+        auto top = u32{};
+        for(auto i = first; i < last; ++i) {
+            base = std::min({base, indices[i].x, indices[i].y, indices[i].z});
+            top = std::max({top, indices[i].x, indices[i].y, indices[i].z});
+        }
+
+        // deltas do not fit in 16 bits -> raw block
+        if(top - base > U16_MAX) {
+            blocks_.push_back({base, static_cast<u32>(raw_.size()) | RAW_BLOCK_});
+            for(auto i = first; i < last; ++i) {
+                raw_.insert(raw_.end(), {indices[i].x, indices[i].y, indices[i].z});
+            }
+        }
+        else {
+            blocks_.push_back({base, static_cast<u32>(deltas_.size())});
+            for(auto i = first; i < last; ++i) {
+                for(u32 k = 0; k < 3; ++k) {
+                    deltas_.push_back(static_cast<u16>(indices[i][k] - base));
+                }
+            }
+        }
+    }
+
+    // bvh refit to the decoded polygons, so traversal never culls a decoded polygon that pokes out of the original bounds
+    // then collapsed to qbvh nodes, whose child bounds are rounded outwards
+    {
+        std::vector<bvh_node> refit(bvh.nodes().begin(), bvh.nodes().end());
+        auto slot_box = [&](auto& self, s32 index) -> aabb {
+            if(index <= 0) {
+                return aabb(decode_(static_cast<u32>(-index)));
+            }
+            auto& node = refit[index];
+            node.left_box = self(self, node.left_index);
+            node.right_box = self(self, node.right_index);
+            return node.left_box + node.right_box;
+        };
+        // root (index 0) is a node, not a leaf
+        refit[0].left_box = slot_box(slot_box, refit[0].left_index);
+        refit[0].right_box = slot_box(slot_box, refit[0].right_index);
+
+        qbvh tree(refit);
+        tree.reorder();
+        nodes_.assign(tree.nodes().begin(), tree.nodes().end());
+    }
+
+    // normals
+    normals_.reserve(mesh.normals.size());
+    for(const auto& n : mesh.normals) {
+        if(dot(n, n) > 0.0f) {
+            normals_.push_back(encode_octahedral(n));
+        }
+        else {
+            normals_.push_back({NO_NORMAL_, 0});
+        }
+    }
+
+    // group index -> material
+    for(const auto& name : mesh.group_names) {
+        materials_.push_back(mesh.mat_info.at(name));
+    }
+}
+
+vec3f32 compressed_mesh::vertex_(u32 vertex) const noexcept {
+    const auto& box = vertex_blocks_[vertex / VERTEX_BLOCK_SIZE_];
+    const auto& q = positions_[vertex];
+    return vec3f32(
+        internal_::dequantize_(q[0], box.min.x, box.max.x),
+        internal_::dequantize_(q[1], box.min.y, box.max.y),
+        internal_::dequantize_(q[2], box.min.z, box.max.z)
+    );
+}
+
+triangle compressed_mesh::decode_(u32 index) const noexcept {
+    auto i = vertex_index_(index);
+    return { vertex_(i.x), vertex_(i.y), vertex_(i.z) };
+}
+
+vec3u32 compressed_mesh::vertex_index_(u32 index) const noexcept {
+    const auto& block = blocks_[index / INDEX_BLOCK_SIZE_];
+    auto corner = (index % INDEX_BLOCK_SIZE_) * 3;
+    if(block.offset & RAW_BLOCK_) {
+        auto p = raw_.data() + (block.offset & ~RAW_BLOCK_) + corner;
+        return { p[0], p[1], p[2] };
+    }
+    auto p = deltas_.data() + block.offset + corner;
+    return { block.base + p[0], block.base + p[1], block.base + p[2] };
+}
+
+std::optional<vec3f32> compressed_mesh::vertex_normal_(u32 vertex) const noexcept {
+    const auto& e = normals_[vertex];
+    if(e[0] == NO_NORMAL_) {
+        return std::nullopt;
+    }
+    return decode_octahedral(e);
+}
+
+std::optional<compressed_hit> compressed_mesh::trace(const ray& r, f32 t_max) const {
+    // same traversal as wide_bvh::trace(), leaves are decoded on the fly
+    auto inv_direction = vec3f32(1.0f / r.direction.x, 1.0f / r.direction.y, 1.0f / r.direction.z);
+
+    std::array<s32, internal_::WIDE_BVH_STACK_SIZE_> stack{};
+    u32 top{};
+    stack[top++] = 0;
+
+    f32 t = t_max;
+    u32 i = U32_MAX;
+    triangle hit_triangle{};
+
+    while(top > 0) {
+        const auto& node = nodes_[stack[--top]];
+
+        for(u32 c = 0; c < 4; ++c) {
+            auto child = node.children[c];
+            if(child == qbvh_node::EMPTY_CHILD || !internal_::hit_box_(r, inv_direction, node.child_box(c), t)) {
+                continue;
+            }
+
+            // internal
+            if(child > 0) {
+                assert(top < stack.size());
+                stack[top++] = child;
+            }
+            // leaf
+            else {
+                auto tri_idx = static_cast<u32>(-child);
+                auto tri = decode_(tri_idx);
+                auto curr_t = intersect(r, tri);
+                if(curr_t && *curr_t < t) {
+                    t = *curr_t;
+                    i = tri_idx;
+                    hit_triangle = tri;
+                }
+            }
+        }
+    }
+
+    if(i == U32_MAX) {
+        return std::nullopt;
+    }
+
+    // geometric normal, replaced by interpolated normal if polygon has normals
+    auto normal = normalize(cross(hit_triangle.p1 - hit_triangle.p0, hit_triangle.p2 - hit_triangle.p0));
+    if(!normals_.empty()) {
+        auto index = vertex_index_(i);
+        auto n0 = vertex_normal_(index.x);
+        auto n1 = vertex_normal_(index.y);
+        auto n2 = vertex_normal_(index.z);
+        if(n0 && n1 && n2) {
+            auto b = hit_triangle.barycentric(r[t]);
+            normal = normalize(b.x * *n0 + b.y * *n1 + b.z * *n2);
+        }
+    }
+
+    return {{i, t, normal}};
+}
+
+usize compressed_mesh::resident_bytes() const noexcept {
+    auto bytes = [](const auto& v) { return v.capacity() * sizeof(v[0]); };
+    return bytes(nodes_) + bytes(vertex_blocks_) + bytes(positions_) + bytes(normals_) + bytes(blocks_) + bytes(deltas_) + bytes(raw_) + bytes(group_indices_) + bytes(materials_);
+}
+
+}
\ No newline at end of file
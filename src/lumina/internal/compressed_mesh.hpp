@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "base.hpp"
+#include "bvh.hpp"
+#include "mesh.hpp"
+#include "qbvh.hpp"
+
+namespace lumina {
+
+// ray hit on compressed_mesh
+struct compressed_hit {
+    u32 index;
+    f32 t;
+    // interpolated shading normal (geometric normal for polygons without normals)
+    vec3f32 normal;
+};
+
+// optional compressed geometry for very large meshes, built from mesh and its bvh
+// - positions: shared through the index buffer like mesh, 3 x 16-bit per vertex relative to the bounds of its block of
+//   VERTEX_BLOCK_SIZE_ consecutive vertices (blocks are tight after mesh::reorder_polygons(), which numbers vertices by first use)
+// - indices: blocks of 16-bit deltas from the smallest index of each block
+// - nodes: qbvh nodes (child bounds 8-bit relative to the node), refit to the decoded polygons
+// - normals: octahedral encoding, 2 x 16-bit per vertex
+// everything is decoded on the fly in leaf intersection / at the hit, mesh and bvh can be released after construction
+// texcoords are not kept
+// vertices shared by polygons decode to the same position, so the compressed surface is as watertight as mesh
+// leaves hold one polygon, so there are about half as many qbvh nodes as polygons
+// lumina_geometry_bench reports the size per polygon against mesh + bvh
+class compressed_mesh {
+    // polygons per index block
+    static constexpr u32 INDEX_BLOCK_SIZE_ = 64;
+    // vertices per quantization box
+    static constexpr u32 VERTEX_BLOCK_SIZE_ = 256;
+    // x of encoded normal for vertices without normal (never produced by encoding)
+    static constexpr s16 NO_NORMAL_ = S16_MIN;
+    // flag of index_block_::offset -> block is stored as raw u32 indices
+    static constexpr u32 RAW_BLOCK_ = 0x80000000u;
+
+    struct index_block_ {
+        u32 base;
+        // offset into deltas_ or raw_ (RAW_BLOCK_)
+        u32 offset;
+    };
+
+    std::vector<qbvh_node> nodes_;
+    // quantization box of each vertex block
+    std::vector<aabb> vertex_blocks_;
+    std::vector<std::array<u16, 3>> positions_;
+    std::vector<std::array<s16, 2>> normals_;
+    std::vector<index_block_> blocks_;
+    std::vector<u16> deltas_;
+    std::vector<u32> raw_;
+    std::vector<u32> group_indices_;
+    std::vector<lumina::material> materials_;
+
+    vec3f32 vertex_(u32 vertex) const noexcept;
+    triangle decode_(u32 index) const noexcept;
+    vec3u32 vertex_index_(u32 index) const noexcept;
+    // std::nullopt for vertices without normal
+    std::optional<vec3f32> vertex_normal_(u32 vertex) const noexcept;
+
+public:
+    // materials are taken from mesh, so add them to mesh before compression
+    // bvh only provides the topology, any split method works (references of spatial splits are refit to whole polygons)
+    compressed_mesh(const mesh& mesh, const bvh& bvh);
+
+    std::optional<compressed_hit> trace(const ray& r, f32 t_max) const;
+
+    const lumina::material& material(u32 index) const {
+        return materials_[group_indices_[index]];
+    }
+
+    // bytes of geometry and bvh nodes held by this object
+    usize resident_bytes() const noexcept;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <thread>
+
+#include "denoise.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+// pixels filtered together in the inner loops, accumulators stay in registers / on the stack
+constexpr u32 DENOISE_CHUNK_ = 64;
+// consecutive rows handed to a thread at once
+constexpr u32 DENOISE_TILE_ROWS_ = 8;
+
+// 2^-x for x >= 0, larger x (and NaN) clamped to 126, relative error below 2e-4
+// the clamp compares bits as integers, float compares are not if-converted under -ftrapping-math and would keep the caller's loop scalar
+inline f32 exp2_negative_(f32 x) noexcept {
+    x = std::bit_cast<f32>(std::min(std::bit_cast<u32>(x), std::bit_cast<u32>(126.0f)));
+    auto i = static_cast<s32>(x);
+    // fraction in (-1, 0]
+    auto t = (static_cast<f32>(i) - x) * 0.69314718f;
+    auto p = 1.0f + t * (1.0f + t * (0.5f + t * (1.0f / 6.0f + t * (1.0f / 24.0f + t * (1.0f / 120.0f)))));
+    return std::bit_cast<f32>(static_cast<u32>(127 - i) << 23) * p;
+}
+
+inline f32 luminance_(f32 r, f32 g, f32 b) noexcept {
+    return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+// f(y) for rows [0, height) on all hardware threads
+template<class F>
+void parallel_rows_(u32 height, F&& f) {
+    auto tiles = (height + DENOISE_TILE_ROWS_ - 1) / DENOISE_TILE_ROWS_;
+    auto thread_count = std::min(std::max<u32>(1, std::thread::hardware_concurrency()), tiles);
+    std::atomic<u32> next{};
+    std::vector<std::thread> threads{};
+    for(u32 t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&] {
+            for(auto tile = next++; tile < tiles; tile = next++) {
+                for(auto y = tile * DENOISE_TILE_ROWS_; y < std::min(height, (tile + 1) * DENOISE_TILE_ROWS_); ++y) {
+                    f(y);
+                }
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+}
+
+// single channel planes with a border of pad pixels, so every tap is an unconditional load
+// border pixels have mask 0 and never contribute
+struct denoise_planes_ {
+    u32 width;
+    u32 height;
+    u32 pad;
+    u32 stride;
+
+    // guides
+    std::vector<f32> nx, ny, nz;
+    std::vector<f32> ar, ag, ab;
+    std::vector<f32> mask;
+
+    // demodulated radiance and its variance, current and next pass
+    std::array<std::vector<f32>, 2> r, g, b, variance;
+    // 1 / (sigma_luminance * standard deviation) of the current pass
+    std::vector<f32> inv_sigma;
+
+    denoise_planes_(u32 width, u32 height, u32 pad) : width(width), height(height), pad(pad), stride(width + 2 * pad) {
+        auto size = usize(stride) * (height + 2 * pad);
+        for(auto* plane : {&nx, &ny, &nz, &ar, &ag, &ab, &mask, &r[0], &g[0], &b[0], &variance[0], &r[1], &g[1], &b[1], &variance[1], &inv_sigma}) {
+            plane->assign(size, 0.0f);
+        }
+    }
+
+    usize at(u32 x, u32 y) const noexcept { return usize(y + pad) * stride + x + pad; }
+};
+
+// luminance variance over the valid pixels of the 5x5 neighbourhood
+void estimate_variance_(denoise_planes_& planes) {
+    parallel_rows_(planes.height, [&](u32 y) {
+        for(u32 x = 0; x < planes.width; ++x) {
+            f32 n{};
+            f32 sum{};
+            f32 sum2{};
+            for(s32 dy = -2; dy <= 2; ++dy) {
+                for(s32 dx = -2; dx <= 2; ++dx) {
+                    if(s32(y) + dy < 0 || s32(y) + dy >= s32(planes.height) || s32(x) + dx < 0 || s32(x) + dx >= s32(planes.width)) {
+                        continue;
+                    }
+                    auto q = planes.at(x + dx, y + dy);
+                    auto l = luminance_(planes.r[0][q], planes.g[0][q], planes.b[0][q]);
+                    n += 1.0f;
+                    sum += l;
+                    sum2 += l * l;
+                }
+            }
+            auto mean = sum / n;
+            planes.variance[0][planes.at(x, y)] = std::max(0.0f, sum2 / n - mean * mean);
+        }
+    });
+}
+
+// one 5x5 a-trous pass with tap spacing step, planes [0] -> [1]
+void atrous_pass_(denoise_planes_& planes, u32 step, const denoise_options& options) {
+    // B3 spline
+    constexpr std::array<f32, 5> kernel = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+    constexpr f32 log2e = 1.44269504f;
+
+    // edge stopping by luminance uses the variance prefiltered with a 3x3 gaussian
+    parallel_rows_(planes.height, [&](u32 y) {
+        for(u32 x = 0; x < planes.width; ++x) {
+            f32 v{};
+            f32 w{};
+            for(s32 dy = -1; dy <= 1; ++dy) {
+                for(s32 dx = -1; dx <= 1; ++dx) {
+                    auto q = planes.at(x, y) + dy * s32(planes.stride) + dx;
+                    auto h = (dx == 0 ? 0.5f : 0.25f) * (dy == 0 ? 0.5f : 0.25f) * planes.mask[q];
+                    v += h * planes.variance[0][q];
+                    w += h;
+                }
+            }
+            planes.inv_sigma[planes.at(x, y)] = 1.0f / (options.sigma_luminance * std::sqrt(v / w) + 1e-6f);
+        }
+    });
+
+    auto sigma_normal = 0.5f * options.sigma_normal * log2e;
+    auto inv_sigma_albedo2 = log2e / (options.sigma_albedo * options.sigma_albedo);
+
+    parallel_rows_(planes.height, [&](u32 y) {
+        const auto* nx = planes.nx.data();
+        const auto* ny = planes.ny.data();
+        const auto* nz = planes.nz.data();
+        const auto* ar = planes.ar.data();
+        const auto* ag = planes.ag.data();
+        const auto* ab = planes.ab.data();
+        const auto* mask = planes.mask.data();
+        const auto* r = planes.r[0].data();
+        const auto* g = planes.g[0].data();
+        const auto* b = planes.b[0].data();
+        const auto* variance = planes.variance[0].data();
+        const auto* inv_sigma = planes.inv_sigma.data();
+
+        for(u32 x0 = 0; x0 < planes.width; x0 += DENOISE_CHUNK_) {
+            auto n = std::min(DENOISE_CHUNK_, planes.width - x0);
+            auto p0 = planes.at(x0, y);
+
+            std::array<f32, DENOISE_CHUNK_> sum_r{}, sum_g{}, sum_b{}, sum_w{}, sum_v{};
+            for(s32 dy = -2; dy <= 2; ++dy) {
+                for(s32 dx = -2; dx <= 2; ++dx) {
+                    auto h = kernel[dy + 2] * kernel[dx + 2];
+                    auto offset = (dy * s32(planes.stride) + dx) * s32(step);
+                    for(u32 i = 0; i < n; ++i) {
+                        auto p = p0 + i;
+                        auto q = p + offset;
+                        auto dl = std::abs(luminance_(r[q], g[q], b[q]) - luminance_(r[p], g[p], b[p]));
+                        auto dn = (nx[q] - nx[p]) * (nx[q] - nx[p]) + (ny[q] - ny[p]) * (ny[q] - ny[p]) + (nz[q] - nz[p]) * (nz[q] - nz[p]);
+                        auto da = (ar[q] - ar[p]) * (ar[q] - ar[p]) + (ag[q] - ag[p]) * (ag[q] - ag[p]) + (ab[q] - ab[p]) * (ab[q] - ab[p]);
+                        // unit normals: |n_p - n_q|^2 / 2 = 1 - cos, escaped pixels (normal 0) only blend with each other
+                        auto w = h * mask[q] * exp2_negative_(dl * inv_sigma[p] * log2e + dn * sigma_normal + da * inv_sigma_albedo2);
+                        sum_r[i] += w * r[q];
+                        sum_g[i] += w * g[q];
+                        sum_b[i] += w * b[q];
+                        sum_w[i] += w;
+                        sum_v[i] += w * w * variance[q];
+                    }
+                }
+            }
+
+            // the center tap has weight kernel[2]^2, sum_w is never 0
+            for(u32 i = 0; i < n; ++i) {
+                auto p = p0 + i;
+                auto inv_w = 1.0f / sum_w[i];
+                planes.r[1][p] = sum_r[i] * inv_w;
+                planes.g[1][p] = sum_g[i] * inv_w;
+                planes.b[1][p] = sum_b[i] * inv_w;
+                planes.variance[1][p] = sum_v[i] * inv_w * inv_w;
+            }
+        }
+    });
+
+    std::swap(planes.r[0], planes.r[1]);
+    std::swap(planes.g[0], planes.g[1]);
+    std::swap(planes.b[0], planes.b[1]);
+    std::swap(planes.variance[0], planes.variance[1]);
+}
+
+}
+
+std::vector<vec3f32> denoise(std::span<const vec3f32> radiance, std::span<const vec3f32> albedo, std::span<const vec3f32> normal, std::span<const f32> variance, u32 width, u32 height, const denoise_options& options) {
+    // farthest tap is 2 * 2^(iterations - 1) pixels away
+    auto pad = options.iterations > 0 ? 1u << options.iterations : 0u;
+    internal_::denoise_planes_ planes(width, height, pad);
+
+    // albedo below this is not divided out (black channels keep their radiance)
+    constexpr f32 min_albedo = 0.01f;
+    std::vector<vec3f32> demodulation(usize(width) * height);
+    internal_::parallel_rows_(height, [&](u32 y) {
+        for(u32 x = 0; x < width; ++x) {
+            auto i = usize(y) * width + x;
+            auto p = planes.at(x, y);
+            const auto& a = albedo[i];
+            auto d = vec3f32(a.r > min_albedo ? a.r : 1.0f, a.g > min_albedo ? a.g : 1.0f, a.b > min_albedo ? a.b : 1.0f);
+            demodulation[i] = d;
+
+            planes.r[0][p] = radiance[i].r / d.r;
+            planes.g[0][p] = radiance[i].g / d.g;
+            planes.b[0][p] = radiance[i].b / d.b;
+            if(!variance.empty()) {
+                auto l = internal_::luminance_(d.r, d.g, d.b);
+                planes.variance[0][p] = variance[i] / (l * l);
+            }
+
+            auto n = normal[i];
+            auto length = n.norm();
+            n = length > 0.0f ? n / length : vec3f32{};
+            planes.nx[p] = n.x;
+            planes.ny[p] = n.y;
+            planes.nz[p] = n.z;
+            planes.ar[p] = a.r;
+            planes.ag[p] = a.g;
+            planes.ab[p] = a.b;
+            planes.mask[p] = 1.0f;
+        }
+    });
+    if(variance.empty()) {
+        internal_::estimate_variance_(planes);
+    }
+
+    for(u32 k = 0; k < options.iterations; ++k) {
+        internal_::atrous_pass_(planes, 1u << k, options);
+    }
+
+    std::vector<vec3f32> pixels(usize(width) * height);
+    for(u32 y = 0; y < height; ++y) {
+        for(u32 x = 0; x < width; ++x) {
+            auto i = usize(y) * width + x;
+            auto p = planes.at(x, y);
+            pixels[i] = vec3f32(planes.r[0][p], planes.g[0][p], planes.b[0][p]) * demodulation[i];
+        }
+    }
+    return pixels;
+}
+
+}
\ No newline at end of file
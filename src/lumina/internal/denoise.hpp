@@ -0,0 +1,30 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "vector.hpp"
+
+namespace lumina {
+
+// edge-avoiding a-trous filter controls
+struct denoise_options {
+    // passes with tap spacing 1, 2, 4, ..., footprint is 4 * (2^iterations - 1) + 1 pixels
+    // more passes blur the glossy reflections on the mori knob scene, which no guide separates
+    u32 iterations = 3;
+    // edge stopping: luminance difference in standard deviations of the noise, normal difference, albedo difference
+    f32 sigma_luminance = 2.0f;
+    f32 sigma_normal = 128.0f;
+    f32 sigma_albedo = 0.1f;
+};
+
+// joint bilateral denoiser guided by the first hit albedo and normal (film::albedo / film::normal)
+// radiance is divided by albedo before filtering so textures are kept, 5x5 a-trous passes weighted by
+// luminance (relative to the filtered variance), normal and albedo similarity
+// variance: film::variance (luminance variance of the pixel mean), empty -> estimated from the 5x5 neighbourhood (1 spp)
+// rows run on all hardware threads, inner loops over padded planes are vectorized
+// reference: Holger Dammertz et al. - "Edge-Avoiding A-Trous Wavelet Transform for fast Global Illumination Filtering", 2010
+// reference: Christoph Schied et al. - "Spatiotemporal Variance-Guided Filtering", 2017
+std::vector<vec3f32> denoise(std::span<const vec3f32> radiance, std::span<const vec3f32> albedo, std::span<const vec3f32> normal, std::span<const f32> variance, u32 width, u32 height, const denoise_options& options = {});
+
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include <cmath>
+
+#include "film.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+// Rec. 709 luminance
+inline f32 luminance_(const vec3f32& c) noexcept {
+    return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b;
+}
+
+// per-pixel buffers of film / film_tile for size pixels, only the enabled outputs are allocated
+struct film_pixel_buffers_ {
+    std::vector<u32>& counts;
+    std::vector<vec3f32>& albedo;
+    std::vector<vec3f32>& normal;
+    std::vector<f32>& depth;
+    std::vector<u32>& primitive;
+    std::vector<f32>& mean;
+    std::vector<f32>& m2;
+
+    void assign(usize size, const film_aovs& aovs) {
+        auto any = aovs.albedo || aovs.normal || aovs.depth || aovs.variance || aovs.sample_count;
+        counts.assign(any ? size : 0, 0);
+        albedo.assign(aovs.albedo ? size : 0, vec3f32{});
+        normal.assign(aovs.normal ? size : 0, vec3f32{});
+        // sum of distances and number of samples that hit
+        depth.assign(aovs.depth ? 2 * size : 0, 0.0f);
+        primitive.assign(aovs.primitive_id ? size : 0, U32_MAX);
+        mean.assign(aovs.variance ? size : 0, 0.0f);
+        m2.assign(aovs.variance ? size : 0, 0.0f);
+    }
+};
+
+}
+
+f32 film_filter::evaluate_1d(f32 d) const noexcept {
+    switch(type) {
+    case film_filter_type::box:
+        // half open, a sample on a pixel border belongs to one pixel only
+        return d > -radius && d <= radius ? 1.0f : 0.0f;
+    case film_filter_type::triangle:
+        return std::max(0.0f, 1.0f - std::abs(d) / radius);
+    case film_filter_type::gaussian: {
+        // shifted to 0 at the radius
+        constexpr f32 alpha = 2.0f;
+        return std::max(0.0f, std::exp(-alpha * d * d) - std::exp(-alpha * radius * radius));
+    }
+    case film_filter_type::mitchell: {
+        // reference: Don P. Mitchell, Arun N. Netravali - "Reconstruction Filters in Computer Graphics", 1988 (B = C = 1/3)
+        constexpr f32 b = 1.0f / 3.0f;
+        constexpr f32 c = 1.0f / 3.0f;
+        auto x = std::abs(2.0f * d / radius);
+        if(x >= 2.0f) {
+            return 0.0f;
+        }
+        if(x >= 1.0f) {
+            return ((-b - 6.0f * c) * x * x * x + (6.0f * b + 30.0f * c) * x * x + (-12.0f * b - 48.0f * c) * x + (8.0f * b + 24.0f * c)) / 6.0f;
+        }
+        return ((12.0f - 9.0f * b - 6.0f * c) * x * x * x + (-18.0f + 12.0f * b + 6.0f * c) * x * x + (6.0f - 2.0f * b)) / 6.0f;
+    }
+    }
+    return 0.0f;
+}
+
+film_tile::film_tile(u32 x0, u32 y0, u32 x1, u32 y1, u32 width, u32 height, const film_options& options)
+: x0_(x0), y0_(y0), x1_(x1), y1_(y1), filter_(options.filter) {
+    // samples lie within half a pixel of their pixel center
+    auto margin = static_cast<u32>(std::floor(filter_.radius + 0.5f));
+    fx0_ = x0 - std::min(x0, margin);
+    fy0_ = y0 - std::min(y0, margin);
+    fx1_ = std::min(width, x1 + margin);
+    fy1_ = std::min(height, y1 + margin);
+
+    auto filtered = usize(fx1_ - fx0_) * (fy1_ - fy0_);
+    radiance_.assign(filtered, vec3f32{});
+    weights_.assign(filtered, 0.0f);
+
+    internal_::film_pixel_buffers_{ counts_, albedo_, normal_, depth_, primitive_, mean_, m2_ }.assign(usize(x1 - x0) * (y1 - y0), options.aovs);
+}
+
+void film_tile::add_sample(u32 x, u32 y, const vec2f32& position, const vec3f32& radiance, const path_first_hit& first_hit) {
+    // splat to the pixel centers within the filter support
+    auto px0 = std::max(s32(fx0_), s32(std::ceil(position.x - filter_.radius)));
+    auto py0 = std::max(s32(fy0_), s32(std::ceil(position.y - filter_.radius)));
+    auto px1 = std::min(s32(fx1_) - 1, s32(std::floor(position.x + filter_.radius)));
+    auto py1 = std::min(s32(fy1_) - 1, s32(std::floor(position.y + filter_.radius)));
+    auto filtered_width = fx1_ - fx0_;
+    for(auto py = py0; py <= py1; ++py) {
+        auto wy = filter_.evaluate_1d(f32(py) - position.y);
+        if(wy == 0.0f) {
+            continue;
+        }
+        for(auto px = px0; px <= px1; ++px) {
+            auto w = wy * filter_.evaluate_1d(f32(px) - position.x);
+            auto i = usize(u32(py) - fy0_) * filtered_width + (u32(px) - fx0_);
+            radiance_[i] += w * radiance;
+            weights_[i] += w;
+        }
+    }
+
+    // per-pixel statistics belong to the pixel that generated the sample
+    auto i = usize(y - y0_) * (x1_ - x0_) + (x - x0_);
+    if(!counts_.empty()) {
+        auto n = ++counts_[i];
+        if(!mean_.empty()) {
+            auto l = internal_::luminance_(radiance);
+            auto delta = l - mean_[i];
+            mean_[i] += delta / f32(n);
+            m2_[i] += delta * (l - mean_[i]);
+        }
+    }
+    if(!albedo_.empty()) {
+        albedo_[i] += first_hit.albedo;
+    }
+    if(!normal_.empty()) {
+        normal_[i] += first_hit.normal;
+    }
+    if(!depth_.empty() && first_hit.depth < F32_MAX) {
+        depth_[2 * i] += first_hit.depth;
+        depth_[2 * i + 1] += 1.0f;
+    }
+    if(!primitive_.empty() && primitive_[i] == U32_MAX) {
+        primitive_[i] = first_hit.primitive;
+    }
+}
+
+film::film(u32 width, u32 height, const film_options& options) : width_(width), height_(height), options_(options) {
+    clear();
+}
+
+film_tile film::tile(u32 x0, u32 y0, u32 x1, u32 y1) const {
+    return film_tile(x0, y0, std::min(x1, width_), std::min(y1, height_), width_, height_, options_);
+}
+
+void film::merge(const film_tile& tile) {
+    std::lock_guard<std::mutex> lock(merge_lock_);
+
+    auto filtered_width = tile.fx1_ - tile.fx0_;
+    for(auto y = tile.fy0_; y < tile.fy1_; ++y) {
+        for(auto x = tile.fx0_; x < tile.fx1_; ++x) {
+            auto i = usize(y - tile.fy0_) * filtered_width + (x - tile.fx0_);
+            radiance_[usize(y) * width_ + x] += tile.radiance_[i];
+            weights_[usize(y) * width_ + x] += tile.weights_[i];
+        }
+    }
+
+    auto tile_width = tile.x1_ - tile.x0_;
+    for(auto y = tile.y0_; y < tile.y1_; ++y) {
+        for(auto x = tile.x0_; x < tile.x1_; ++x) {
+            auto i = usize(y - tile.y0_) * tile_width + (x - tile.x0_);
+            auto j = usize(y) * width_ + x;
+            if(!counts_.empty()) {
+                auto n_a = counts_[j];
+                auto n_b = tile.counts_[i];
+                counts_[j] = n_a + n_b;
+                // combined mean and squared deviations of two sample sets
+                // reference: Tony F. Chan, Gene H. Golub, Randall J. LeVeque - "Updating Formulae and a Pairwise Algorithm for Computing Sample Variances", 1979
+                if(!mean_.empty() && n_b != 0) {
+                    auto n = f32(n_a + n_b);
+                    auto delta = tile.mean_[i] - mean_[j];
+                    mean_[j] += delta * f32(n_b) / n;
+                    m2_[j] += tile.m2_[i] + delta * delta * f32(n_a) * f32(n_b) / n;
+                }
+            }
+            if(!albedo_.empty()) {
+                albedo_[j] += tile.albedo_[i];
+            }
+            if(!normal_.empty()) {
+                normal_[j] += tile.normal_[i];
+            }
+            if(!depth_.empty()) {
+                depth_[2 * j] += tile.depth_[2 * i];
+                depth_[2 * j + 1] += tile.depth_[2 * i + 1];
+            }
+            if(!primitive_.empty() && primitive_[j] == U32_MAX) {
+                primitive_[j] = tile.primitive_[i];
+            }
+        }
+    }
+}
+
+void film::clear() {
+    std::lock_guard<std::mutex> lock(merge_lock_);
+
+    auto size = usize(width_) * height_;
+    radiance_.assign(size, vec3f32{});
+    weights_.assign(size, 0.0f);
+    internal_::film_pixel_buffers_{ counts_, albedo_, normal_, depth_, primitive_, mean_, m2_ }.assign(size, options_.aovs);
+}
+
+std::vector<vec3f32> film::image() const {
+    std::vector<vec3f32> pixels(radiance_.size());
+    for(usize i = 0; i < pixels.size(); ++i) {
+        pixels[i] = weights_[i] != 0.0f ? radiance_[i] / weights_[i] : vec3f32{};
+    }
+    return pixels;
+}
+
+std::vector<vec3f32> film::albedo() const {
+    std::vector<vec3f32> pixels(albedo_.size());
+    for(usize i = 0; i < pixels.size(); ++i) {
+        pixels[i] = counts_[i] != 0 ? albedo_[i] / f32(counts_[i]) : vec3f32{};
+    }
+    return pixels;
+}
+
+std::vector<vec3f32> film::normal() const {
+    std::vector<vec3f32> pixels(normal_.size());
+    for(usize i = 0; i < pixels.size(); ++i) {
+        pixels[i] = counts_[i] != 0 ? normal_[i] / f32(counts_[i]) : vec3f32{};
+    }
+    return pixels;
+}
+
+std::vector<f32> film::depth() const {
+    std::vector<f32> pixels(depth_.size() / 2);
+    for(usize i = 0; i < pixels.size(); ++i) {
+        pixels[i] = depth_[2 * i + 1] != 0.0f ? depth_[2 * i] / depth_[2 * i + 1] : F32_MAX;
+    }
+    return pixels;
+}
+
+std::vector<u32> film::primitive_ids() const {
+    return primitive_;
+}
+
+std::vector<f32> film::variance() const {
+    std::vector<f32> pixels(m2_.size());
+    for(usize i = 0; i < pixels.size(); ++i) {
+        auto n = f32(counts_[i]);
+        pixels[i] = counts_[i] > 1 ? m2_[i] / (n - 1.0f) / n : 0.0f;
+    }
+    return pixels;
+}
+
+std::vector<u32> film::sample_counts() const {
+    return options_.aovs.sample_count ? counts_ : std::vector<u32>{};
+}
+
+}
\ No newline at end of file
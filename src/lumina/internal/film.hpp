@@ -0,0 +1,143 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "integrator.hpp"
+#include "vector.hpp"
+
+namespace lumina {
+
+enum class film_filter_type {
+    box,
+    triangle,
+    gaussian,
+    mitchell,
+};
+
+// separable pixel reconstruction filter, support is [-radius, radius]^2 pixels around a sample
+// samples are uniform over their pixel and splatted to every pixel center within the support
+// box with radius 0.5 is the plain per-pixel mean
+// reference: Matt Pharr, Wenzel Jakob, Greg Humphreys - "Physically Based Rendering", 3rd edition, 7.8
+struct film_filter {
+    film_filter_type type = film_filter_type::box;
+    f32 radius = 0.5f;
+
+    f32 evaluate(f32 dx, f32 dy) const noexcept { return evaluate_1d(dx) * evaluate_1d(dy); }
+
+    f32 evaluate_1d(f32 d) const noexcept;
+};
+
+// auxiliary outputs kept besides radiance, disabled ones cost no memory
+struct film_aovs {
+    // mean of the first hit albedo / shading normal / distance
+    bool albedo = false;
+    bool normal = false;
+    bool depth = false;
+    // polygon of the first sample of each pixel that hit something
+    bool primitive_id = false;
+    // variance of the mean luminance of the pixel (sample variance / samples)
+    bool variance = false;
+    bool sample_count = false;
+};
+
+struct film_options {
+    film_filter filter{};
+    film_aovs aovs{};
+};
+
+// accumulation buffers of a rectangle of the film, owned by one thread
+// radiance covers the rectangle grown by the filter radius, per-pixel statistics cover the rectangle itself
+class film_tile {
+    friend class film;
+
+    // pixels [x0_, x1_) x [y0_, y1_) generate samples
+    u32 x0_;
+    u32 y0_;
+    u32 x1_;
+    u32 y1_;
+    // pixels [fx0_, fx1_) x [fy0_, fy1_) receive filtered radiance
+    u32 fx0_;
+    u32 fy0_;
+    u32 fx1_;
+    u32 fy1_;
+    film_filter filter_;
+
+    // filtered region
+    std::vector<vec3f32> radiance_;
+    std::vector<f32> weights_;
+
+    // tile pixels: sums of first hit quantities, primitive of the first sample that hit, luminance mean and squared deviations (Welford)
+    // depth_ holds (sum of distances, number of hits) pairs
+    std::vector<u32> counts_;
+    std::vector<vec3f32> albedo_;
+    std::vector<vec3f32> normal_;
+    std::vector<f32> depth_;
+    std::vector<u32> primitive_;
+    std::vector<f32> mean_;
+    std::vector<f32> m2_;
+
+    film_tile(u32 x0, u32 y0, u32 x1, u32 y1, u32 width, u32 height, const film_options& options);
+
+public:
+    // sample of pixel (x, y) at continuous film position (pixel centers at integers, see camera::sample_position)
+    void add_sample(u32 x, u32 y, const vec2f32& position, const vec3f32& radiance, const path_first_hit& first_hit);
+
+    u32 x0() const noexcept { return x0_; }
+    u32 y0() const noexcept { return y0_; }
+    u32 x1() const noexcept { return x1_; }
+    u32 y1() const noexcept { return y1_; }
+};
+
+// radiance and auxiliary outputs of the whole image, row major
+// threads render into their own film_tile and merge it when done, so samples are accumulated without atomics
+// merging a tile again (progressive passes) keeps accumulating, clear() starts over
+class film {
+    u32 width_;
+    u32 height_;
+    film_options options_;
+
+    // one merge at a time, neighbouring tiles overlap by the filter radius
+    std::mutex merge_lock_;
+
+    std::vector<vec3f32> radiance_;
+    std::vector<f32> weights_;
+
+    std::vector<u32> counts_;
+    std::vector<vec3f32> albedo_;
+    std::vector<vec3f32> normal_;
+    std::vector<f32> depth_;
+    std::vector<u32> primitive_;
+    std::vector<f32> mean_;
+    std::vector<f32> m2_;
+
+public:
+    film(u32 width, u32 height, const film_options& options = {});
+
+    // empty buffers for pixels [x0, x1) x [y0, y1)
+    film_tile tile(u32 x0, u32 y0, u32 x1, u32 y1) const;
+
+    // thread safe
+    void merge(const film_tile& tile);
+
+    void clear();
+
+    // filtered radiance, 0 where no sample contributed
+    std::vector<vec3f32> image() const;
+
+    // auxiliary outputs, empty if not enabled in film_aovs
+    std::vector<vec3f32> albedo() const;
+    std::vector<vec3f32> normal() const;
+    // F32_MAX where every sample escaped
+    std::vector<f32> depth() const;
+    // polygon of the first sample that hit, U32_MAX where every sample escaped
+    std::vector<u32> primitive_ids() const;
+    std::vector<f32> variance() const;
+    std::vector<u32> sample_counts() const;
+
+    u32 width() const noexcept { return width_; }
+    u32 height() const noexcept { return height_; }
+    const film_options& options() const noexcept { return options_; }
+};
+
+}
\ No newline at end of file
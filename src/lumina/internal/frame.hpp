@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+
+#include "vector.hpp"
+
+namespace lumina {
+
+// orthonormal shading frame (s, t, n)
+// build once per hit and reuse for every sample / BSDF evaluation at that point
+// reference: Tom Duff, James Burgess, Per Christensen, Christophe Hery, Andrew Kensler, Max Liani, Ryusuke Villemin - "Building an Orthonormal Basis, Revisited", 2017
+struct frame {
+    vec3f32 s;
+    vec3f32 t;
+    vec3f32 n;
+
+    constexpr frame() noexcept : s(1.0f, 0.0f, 0.0f), t(0.0f, 1.0f, 0.0f), n(0.0f, 0.0f, 1.0f) {}
+    constexpr frame(const vec3f32& s, const vec3f32& t, const vec3f32& n) noexcept : s(s), t(t), n(n) {}
+
+    // vector n should be normalized
+    explicit frame(const vec3f32& n) noexcept : n(n) {
+        auto sign = std::copysign(1.0f, n.z);
+        auto a = -1.0f / (sign + n.z);
+        auto b = n.x * n.y * a;
+        s = vec3f32(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+        t = vec3f32(b, sign + n.y * n.y * a, -n.y);
+    }
+
+    // world space -> (s, t, n) coordinates
+    constexpr vec3f32 to_local(const vec3f32& v) const noexcept {
+        return { dot(v, s), dot(v, t), dot(v, n) };
+    }
+
+    // (s, t, n) coordinates -> world space
+    constexpr vec3f32 to_world(const vec3f32& v) const noexcept {
+        return s * v.x + t * v.y + n * v.z;
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const frame& f) {
+    os << std::format("s: {}, t: {}, n: {}", f.s, f.t, f.n);
+    return os;
+}
+
+}
+
+template<>
+struct std::formatter<lumina::frame> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        auto iter = ctx.begin();
+        return iter;
+    }
+
+    auto format(const lumina::frame& f, std::format_context& ctx) const {
+        return std::format_to(ctx.out(), "s: {}, t: {}, n: {}", f.s, f.t, f.n);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "vector.hpp"
+
+namespace lumina {
+
+// false colour of t in [0, 1], dark blue (low) -> green -> dark red (high)
+// reference: Anton Mikhailov - "Turbo, An Improved Rainbow Colormap for Visualization", 2019 (polynomial fit by Ruofei Du)
+inline vec3f32 false_color(f32 t) noexcept {
+    auto x = std::clamp(t, 0.0f, 1.0f);
+    auto x2 = x * x;
+    auto x3 = x2 * x;
+    auto x4 = x2 * x2;
+    auto x5 = x4 * x;
+    auto r = 0.13572138f + 4.61539260f * x - 42.66032258f * x2 + 132.13108234f * x3 - 152.94239396f * x4 + 59.28637943f * x5;
+    auto g = 0.09140261f + 2.19418839f * x + 4.84296658f * x2 - 14.18503333f * x3 + 4.27729857f * x4 + 2.82956604f * x5;
+    auto b = 0.10667330f + 12.64194608f * x - 60.58204836f * x2 + 110.36276771f * x3 - 89.90310912f * x4 + 27.34824973f * x5;
+    return { std::clamp(r, 0.0f, 1.0f), std::clamp(g, 0.0f, 1.0f), std::clamp(b, 0.0f, 1.0f) };
+}
+
+// scale of a heatmap: value at percentile, so a few extreme pixels do not flatten the rest
+inline f64 heatmap_scale(std::span<const f64> values, f64 percentile = 0.99) {
+    if(values.empty()) {
+        return 0.0;
+    }
+    std::vector<f64> sorted(values.begin(), values.end());
+    auto nth = sorted.begin() + static_cast<std::ptrdiff_t>(percentile * f64(sorted.size() - 1));
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+}
+
+// per pixel values -> false colour image, values >= scale are saturated
+inline std::vector<vec3f32> heatmap(std::span<const f64> values, f64 scale) {
+    std::vector<vec3f32> pixels(values.size());
+    for(size_t i = 0; i < values.size(); ++i) {
+        pixels[i] = false_color(scale > 0.0 ? f32(values[i] / scale) : 0.0f);
+    }
+    return pixels;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include <array>
+#include <bit>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "image.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+// little-endian value at the end of buffer
+template<class T>
+void append_le_(std::vector<u8>& buffer, T value) {
+    auto bits = std::bit_cast<std::conditional_t<sizeof(T) == 8, u64, std::conditional_t<sizeof(T) == 4, u32, std::conditional_t<sizeof(T) == 2, u16, u8>>>>(value);
+    for(usize i = 0; i < sizeof(T); ++i) {
+        buffer.push_back(static_cast<u8>(bits >> (8 * i)));
+    }
+}
+
+template<class T>
+void append_be_(std::vector<u8>& buffer, T value) {
+    for(usize i = sizeof(T); i-- > 0;) {
+        buffer.push_back(static_cast<u8>(value >> (8 * i)));
+    }
+}
+
+inline void append_string_(std::vector<u8>& buffer, std::string_view s) {
+    buffer.insert(buffer.end(), s.begin(), s.end());
+}
+
+// [0, 1] -> 8-bit, NaN -> 0
+inline u8 to_u8_(f32 v) noexcept {
+    return static_cast<u8>((v > 0.0f ? std::min(v, 1.0f) : 0.0f) * 255.999f);
+}
+
+bool write_file_(const std::filesystem::path& path, const std::vector<u8>& buffer) {
+    std::ofstream ofs(path, std::ios::binary);
+    if(ofs.fail()) {
+        std::clog << std::format("failed to create file: {}", path.string()) << std::endl;
+        return false;
+    }
+    ofs.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    if(ofs.fail()) {
+        std::clog << std::format("failed to write file: {}", path.string()) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// reference: ISO/IEC 15948 (PNG), Annex D
+constexpr std::array<u32, 256> CRC_TABLE_ = [] {
+    std::array<u32, 256> table{};
+    for(u32 n = 0; n < 256; ++n) {
+        auto c = n;
+        for(u32 k = 0; k < 8; ++k) {
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+    return table;
+}();
+
+inline u32 crc32_(std::span<const u8> data) noexcept {
+    auto c = 0xffffffffu;
+    for(auto b : data) {
+        c = CRC_TABLE_[(c ^ b) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+}
+
+// reference: RFC 1950 (zlib), 5552 = largest n with 255n(n+1)/2 + (n+1)(65521-1) < 2^32
+inline u32 adler32_(std::span<const u8> data) noexcept {
+    constexpr u32 base = 65521;
+    u32 a = 1;
+    u32 b = 0;
+    for(usize i = 0; i < data.size();) {
+        auto end = std::min(data.size(), i + 5552);
+        for(; i < end; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= base;
+        b %= base;
+    }
+    return b << 16 | a;
+}
+
+inline void append_png_chunk_(std::vector<u8>& buffer, const char* type, std::span<const u8> data) {
+    append_be_(buffer, static_cast<u32>(data.size()));
+    auto start = buffer.size();
+    append_string_(buffer, type);
+    buffer.insert(buffer.end(), data.begin(), data.end());
+    append_be_(buffer, crc32_(std::span(buffer).subspan(start)));
+}
+
+}
+
+u16 to_half(f32 f) noexcept {
+    auto x = std::bit_cast<u32>(f);
+    auto sign = static_cast<u16>((x >> 16) & 0x8000);
+    auto exponent = static_cast<s32>((x >> 23) & 0xff);
+    auto mantissa = x & 0x7fffff;
+
+    // infinity / NaN (quiet)
+    if(exponent == 0xff) {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+
+    auto e = exponent - 127 + 15;
+    if(e >= 31) {
+        return sign | 0x7c00;
+    }
+
+    // subnormal half (or zero): value = mantissa * 2^-24
+    if(e <= 0) {
+        if(e < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        auto shift = static_cast<u32>(14 - e);
+        auto h = mantissa >> shift;
+        auto rest = mantissa & ((1u << shift) - 1);
+        auto halfway = 1u << (shift - 1);
+        h += rest > halfway || (rest == halfway && (h & 1)) ? 1 : 0;
+        return sign | static_cast<u16>(h);
+    }
+
+    // rounding may carry into the exponent, which is still correct (up to infinity)
+    auto h = static_cast<u32>(e) << 10 | mantissa >> 13;
+    auto rest = mantissa & 0x1fff;
+    h += rest > 0x1000 || (rest == 0x1000 && (h & 1)) ? 1 : 0;
+    return sign | static_cast<u16>(h);
+}
+
+bool save_pfm(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height) {
+    // negative scale -> little-endian, rows are stored bottom to top
+    std::vector<u8> buffer{};
+    internal_::append_string_(buffer, std::format("PF\n{} {}\n-1.0\n", width, height));
+    buffer.reserve(buffer.size() + pixels.size() * 12);
+    for(u32 y = height; y-- > 0;) {
+        for(const auto& p : pixels.subspan(usize(y) * width, width)) {
+            internal_::append_le_(buffer, p.r);
+            internal_::append_le_(buffer, p.g);
+            internal_::append_le_(buffer, p.b);
+        }
+    }
+    return internal_::write_file_(path, buffer);
+}
+
+// reference: OpenEXR - "OpenEXR File Layout"
+bool save_exr(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height) {
+    std::vector<u8> buffer{};
+    auto attribute = [&](std::string_view name, std::string_view type, u32 size) {
+        internal_::append_string_(buffer, name);
+        buffer.push_back(0);
+        internal_::append_string_(buffer, type);
+        buffer.push_back(0);
+        internal_::append_le_(buffer, size);
+    };
+
+    // magic number, version 2, single part scanline file
+    internal_::append_le_(buffer, 20000630u);
+    internal_::append_le_(buffer, 2u);
+
+    // channels in alphabetical order: half, linear, sampling 1 x 1
+    attribute("channels", "chlist", 3 * 18 + 1);
+    for(auto name : {"B", "G", "R"}) {
+        internal_::append_string_(buffer, name);
+        buffer.push_back(0);
+        internal_::append_le_(buffer, 1u);
+        internal_::append_le_(buffer, 0u);
+        internal_::append_le_(buffer, 1u);
+        internal_::append_le_(buffer, 1u);
+    }
+    buffer.push_back(0);
+
+    attribute("compression", "compression", 1);
+    buffer.push_back(0);
+    for(auto name : {"dataWindow", "displayWindow"}) {
+        attribute(name, "box2i", 16);
+        internal_::append_le_(buffer, 0u);
+        internal_::append_le_(buffer, 0u);
+        internal_::append_le_(buffer, width - 1);
+        internal_::append_le_(buffer, height - 1);
+    }
+    attribute("lineOrder", "lineOrder", 1);
+    buffer.push_back(0);
+    attribute("pixelAspectRatio", "float", 4);
+    internal_::append_le_(buffer, 1.0f);
+    attribute("screenWindowCenter", "v2f", 8);
+    internal_::append_le_(buffer, 0.0f);
+    internal_::append_le_(buffer, 0.0f);
+    attribute("screenWindowWidth", "float", 4);
+    internal_::append_le_(buffer, 1.0f);
+    buffer.push_back(0);
+
+    // offset table, then one chunk per scanline: y, byte count, planar B, G, R
+    auto line_bytes = width * 3 * 2;
+    auto first_line = buffer.size() + usize(height) * 8;
+    for(u32 y = 0; y < height; ++y) {
+        internal_::append_le_(buffer, static_cast<u64>(first_line + usize(y) * (8 + line_bytes)));
+    }
+    buffer.reserve(first_line + usize(height) * (8 + line_bytes));
+    for(u32 y = 0; y < height; ++y) {
+        auto line = pixels.subspan(usize(y) * width, width);
+        internal_::append_le_(buffer, y);
+        internal_::append_le_(buffer, line_bytes);
+        for(auto c : {2, 1, 0}) {
+            for(const auto& p : line) {
+                internal_::append_le_(buffer, to_half(p[c]));
+            }
+        }
+    }
+
+    return internal_::write_file_(path, buffer);
+}
+
+bool save_ppm(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height) {
+    std::vector<u8> buffer{};
+    internal_::append_string_(buffer, std::format("P6\n{} {}\n255\n", width, height));
+    buffer.reserve(buffer.size() + pixels.size() * 3);
+    for(const auto& p : pixels) {
+        buffer.push_back(internal_::to_u8_(p.r));
+        buffer.push_back(internal_::to_u8_(p.g));
+        buffer.push_back(internal_::to_u8_(p.b));
+    }
+    return internal_::write_file_(path, buffer);
+}
+
+bool save_png(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height) {
+    // filter type 0 (none) + rgb per row
+    std::vector<u8> raw{};
+    raw.reserve(usize(height) * (1 + usize(width) * 3));
+    for(u32 y = 0; y < height; ++y) {
+        raw.push_back(0);
+        for(const auto& p : pixels.subspan(usize(y) * width, width)) {
+            raw.push_back(internal_::to_u8_(p.r));
+            raw.push_back(internal_::to_u8_(p.g));
+            raw.push_back(internal_::to_u8_(p.b));
+        }
+    }
+
+    // zlib stream of stored deflate blocks (up to 65535 bytes each)
+    // reference: RFC 1951 (deflate) 3.2.4
+    constexpr usize block_size = 65535;
+    std::vector<u8> zlib{0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / block_size * 5 + 16);
+    for(usize offset = 0; offset < raw.size(); offset += block_size) {
+        auto size = std::min(block_size, raw.size() - offset);
+        // final block flag, block type 00 (stored)
+        zlib.push_back(offset + size == raw.size() ? 1 : 0);
+        internal_::append_le_(zlib, static_cast<u16>(size));
+        internal_::append_le_(zlib, static_cast<u16>(~size));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+    internal_::append_be_(zlib, internal_::adler32_(raw));
+
+    std::vector<u8> header{};
+    internal_::append_be_(header, width);
+    internal_::append_be_(header, height);
+    // 8-bit rgb, deflate, adaptive filtering, no interlace
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    std::vector<u8> buffer{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    buffer.reserve(zlib.size() + 64);
+    internal_::append_png_chunk_(buffer, "IHDR", header);
+    internal_::append_png_chunk_(buffer, "IDAT", zlib);
+    internal_::append_png_chunk_(buffer, "IEND", {});
+    return internal_::write_file_(path, buffer);
+}
+
+}
\ No newline at end of file
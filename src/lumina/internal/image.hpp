@@ -0,0 +1,27 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+
+#include "vector.hpp"
+
+namespace lumina {
+
+// image writers
+// pixels are row major, top row first, width * height linear rgb values
+// every file is assembled in memory and written with a single write, false (with a message on std::clog) if writing failed
+
+// full range: portable float map, 32-bit float rgb
+bool save_pfm(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height);
+
+// full range: OpenEXR, uncompressed scanlines of 16-bit float rgb (half covers 6.1e-5 .. 65504 at 11-bit precision)
+bool save_exr(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height);
+
+// previews: binary PPM (P6) / PNG (stored deflate blocks, no compression), 8-bit, values clamped to [0, 1]
+bool save_ppm(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height);
+bool save_png(const std::filesystem::path& path, std::span<const vec3f32> pixels, u32 width, u32 height);
+
+// IEEE 754 binary16 with round to nearest even, overflow -> infinity
+u16 to_half(f32 f) noexcept;
+
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <optional>
+#include <span>
+
+#include "bsdf.hpp"
+#include "bvh.hpp"
+#include "compressed_mesh.hpp"
+#include "mesh.hpp"
+#include "qbvh.hpp"
+#include "sampler.hpp"
+#include "statistics.hpp"
+
+namespace lumina {
+
+// path length controls
+struct path_options {
+    // russian roulette is applied after this number of traced rays
+    u32 min_depth = 3;
+    // hard limit of traced rays per path
+    u32 max_depth = 32;
+};
+
+// radiance of rays leaving the scene
+constexpr vec3f32 BACKGROUND_RADIANCE = vec3f32(0.2f);
+
+// first surface seen by a camera path, auxiliary outputs for film and denoising
+struct path_first_hit {
+    // albedo of the material, 1 if the ray escaped (radiance / albedo is the radiance itself)
+    vec3f32 albedo = vec3f32(1.0f);
+    // shading normal facing the ray origin, 0 if the ray escaped
+    vec3f32 normal;
+    // ray parameter of the hit (distance for normalized directions), F32_MAX if the ray escaped
+    f32 depth = F32_MAX;
+    // polygon index, U32_MAX if the ray escaped
+    u32 primitive = U32_MAX;
+};
+
+struct path_result {
+    vec3f32 radiance;
+    // number of traced rays (including the final one that escaped or was terminated)
+    u32 length;
+    path_first_hit first_hit;
+};
+
+// closest hit (polygon index, t) of mesh polygons: bvh / qbvh / wide_bvh
+template<class A>
+concept triangle_accelerator = requires(const A& a, std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters& counters) {
+    { a.trace(vertices, indices, r, t_max) } -> std::same_as<std::optional<std::pair<u32, f32>>>;
+    { a.trace(vertices, indices, r, t_max, counters) } -> std::same_as<std::optional<std::pair<u32, f32>>>;
+};
+
+namespace internal_ {
+
+// closest hit seen by the path tracer, independent of the geometry representation
+struct surface_hit_ {
+    f32 t;
+    // shading normal, not flipped to the ray side
+    vec3f32 normal;
+    const lumina::material* mat;
+    // polygon index of the geometry representation
+    u32 index;
+};
+
+// closest hit of mesh polygons through accelerator: ray -> std::optional<surface_hit_>
+// counters: traversal work of every query is added to it, nullptr -> not counted
+template<triangle_accelerator Accelerator>
+auto closest_hit_of_(const Accelerator& bvh, const mesh& mesh, trace_counters* counters = nullptr) {
+    return [&bvh, &mesh, counters](const ray& r) -> std::optional<surface_hit_> {
+        auto test_result = counters ? bvh.trace(mesh.vertices, mesh.vertex_indices, r, F32_MAX, *counters) : bvh.trace(mesh.vertices, mesh.vertex_indices, r, F32_MAX);
+        if(!test_result) {
+            return std::nullopt;
+        }
+        auto [index_index, t] = *test_result;
+        return surface_hit_{ t, mesh.normal(r[t], index_index), &mesh.material(index_index), index_index };
+    };
+}
+
+// traversal counters of the calling thread with LUMINA_STATISTICS, nullptr otherwise
+inline trace_counters* statistics_counters_() noexcept {
+    if constexpr(STATISTICS_ENABLED) {
+        return &thread_statistics().traversal;
+    }
+    else {
+        return nullptr;
+    }
+}
+
+// default policy of trace_path_: the path goes on at every surface
+struct never_stop_ {
+    std::optional<vec3f32> operator()(const material&, const vec3f32&, const vec3f32&, const bsdf&, const vec3f32&) const noexcept {
+        return std::nullopt;
+    }
+};
+
+// from: https://rayspace.xyz/CG/contents/path_tracing_implementation/
+// with russian roulette
+// throughput alpha is weighted by f * cos / pdf of the sampled BSDF direction
+// survival probability of russian roulette follows the throughput, so bright paths are kept and dim paths are cut early
+// closest_hit: ray -> std::optional<surface_hit_>
+// stop: (material, position, omega_o, bsdf, throughput) -> radiance added when the path ends on this surface (after its emission), std::nullopt to go on
+template<class ClosestHit, class RandGen, class Stop = never_stop_>
+path_result trace_path_(const ray& r, ClosestHit&& closest_hit, RandGen& rng, const path_options& options, Stop&& stop = {}) {
+    constexpr f32 eps = 0.0001f;
+
+    vec3f32 i_j{};
+    vec3f32 alpha = vec3f32(1.0f);
+
+    auto ray = r;
+    u32 length{};
+    path_first_hit first_hit{};
+
+    while(length < options.max_depth) {
+        ++length;
+
+        auto hit = closest_hit(ray);
+        if constexpr(STATISTICS_ENABLED) {
+            auto& statistics = thread_statistics();
+            ++statistics.rays;
+            statistics.hits += hit ? 1 : 0;
+        }
+
+        if(!hit) {
+            i_j += alpha * BACKGROUND_RADIANCE;
+            break;
+        }
+
+        const auto& material = *hit->mat;
+
+        auto x = ray[hit->t];
+        auto n = hit->normal;
+        // ray hits the front face -> entering the surface
+        auto entering = dot(ray.direction, n) < 0.0f;
+        n = entering ? n : -n;
+        auto omega_o = -ray.direction;
+
+        bsdf surface(material, frame(n), entering);
+
+        if(length == 1) {
+            first_hit = { material.albedo, n, hit->t, hit->index };
+        }
+
+        if(material.emission.norm() != 0.0f) {
+            i_j += alpha * material.emission;
+        }
+
+        if(auto last = stop(material, x, omega_o, surface, alpha)) {
+            i_j += *last;
+            break;
+        }
+
+        auto sample = surface.sample(omega_o, rng);
+        if(!sample) {
+            break;
+        }
+
+        alpha *= sample->weight;
+
+        if(length >= options.min_depth) {
+            auto p_rr = std::min(1.0f, std::max({alpha.r, alpha.g, alpha.b}));
+            if(uniform_1d(rng) >= p_rr) {
+                break;
+            }
+            alpha *= 1.0f / p_rr;
+        }
+
+        // offset to the side the sampled direction leaves from (refraction goes below the surface)
+        auto offset = dot(sample->omega_i, n) > 0.0f ? n * eps : -n * eps;
+        ray = lumina::ray(x + offset, sample->omega_i);
+    }
+
+    if constexpr(STATISTICS_ENABLED) {
+        auto& statistics = thread_statistics();
+        ++statistics.samples;
+        ++statistics.path_depths[std::min(length, PATH_DEPTH_BINS - 1)];
+    }
+
+    return { i_j, length, first_hit };
+}
+
+}
+
+// RandGen: sampler (sobol_sampler etc.) or raw RNG
+template<triangle_accelerator Accelerator, class RandGen>
+path_result trace_ray(const ray& r, const Accelerator& bvh, const mesh& mesh, RandGen& rng, const path_options& options = {}) {
+    return internal_::trace_path_(r, internal_::closest_hit_of_(bvh, mesh, internal_::statistics_counters_()), rng, options);
+}
+
+// same as above, adds the traversal work of every ray of the path to counters (cost heatmaps)
+template<triangle_accelerator Accelerator, class RandGen>
+path_result trace_ray(const ray& r, const Accelerator& bvh, const mesh& mesh, RandGen& rng, const path_options& options, trace_counters& counters) {
+    return internal_::trace_path_(r, internal_::closest_hit_of_(bvh, mesh, &counters), rng, options);
+}
+
+// same path tracer on compressed geometry
+template<class RandGen>
+path_result trace_ray(const ray& r, const compressed_mesh& mesh, RandGen& rng, const path_options& options = {}) {
+    auto closest_hit = [&](const lumina::ray& ray) -> std::optional<internal_::surface_hit_> {
+        auto hit = mesh.trace(ray, F32_MAX);
+        if(!hit) {
+            return std::nullopt;
+        }
+        return internal_::surface_hit_{ hit->t, hit->normal, &mesh.material(hit->index), hit->index };
+    };
+    return internal_::trace_path_(r, closest_hit, rng, options);
+}
+
+}
\ No newline at end of file
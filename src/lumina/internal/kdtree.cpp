@@ -1,78 +1,126 @@
+#include <atomic>
+#include <bit>
+#include <thread>
+
+#include "aabb.hpp"
 #include "kdtree.hpp"
 
 namespace lumina {
 
-kdtree::kdtree(std::vector<vec3f32> src) {
-    // empty source -> empty tree
-    if(src.size() == 0) {
-        points_ = {};
-        height_ = 0;
-        return;
+namespace internal_ {
+
+// point with its source index, partitioned in place while building
+struct kdtree_entry_ {
+    vec3f32 point;
+    u32 index;
+};
+
+// range [begin, end) of entries that becomes the subtree of node
+struct kdtree_task_ {
+    u32 begin;
+    u32 end;
+    u32 node;
+};
+
+// size of the left subtree of a left-balanced tree with size nodes
+// levels above the last one are full, the last level is filled from the left
+inline u32 left_subtree_size_(u32 size) noexcept {
+    if(size <= 1) {
+        return 0;
     }
+    auto height = static_cast<u32>(std::bit_width(size)) - 1;
+    auto full = (1u << height) - 1;
+    auto last = size - full;
+    return (full - 1) / 2 + std::min(last, 1u << (height - 1));
+}
 
-    // calculate height of kD-tree
-    height_ = std::floor(std::log2(src.size()));
-    // number of elements = 2^(height + 1) - 1
-    points_.resize(std::pow(2, height_ + 1) - 1, SENTRY_);
+// median of the task along its largest extent becomes the node, returns the tasks of both children (empty if end == begin)
+inline std::pair<kdtree_task_, kdtree_task_> split_task_(std::span<kdtree_entry_> entries, const kdtree_task_& task, std::span<u32> order, std::span<u8> axes) {
+    aabb box{};
+    for(auto i = task.begin; i < task.end; ++i) {
+        box += aabb(entries[i].point, entries[i].point);
+    }
+    auto extent = box.max - box.min;
+    u8 axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
 
-    using iter_t = std::vector<vec3f32>::iterator;
-    // (iter_begin, iter_end, height, index)
-    std::stack<std::tuple<iter_t, iter_t, u32, u32>> s{};
-    s.push({src.begin(), src.end(), 0, 0});
+    auto median = task.begin + left_subtree_size_(task.end - task.begin);
+    std::nth_element(entries.begin() + task.begin, entries.begin() + median, entries.begin() + task.end, [axis](const auto& l, const auto& r) { return l.point[axis] < r.point[axis]; });
 
-    while(!s.empty()) {
-        auto [b, e, h, i] = s.top();
-        s.pop();
-        
-        auto d = std::distance(b, e);
+    order[task.node] = entries[median].index;
+    axes[task.node] = axis;
 
-        auto axis = h % 3;
-        std::nth_element(b, b + d / 2, e, [&](const auto& a, const auto& b) { return a[axis] < b[axis]; });
+    return {
+        { task.begin, median, 2 * task.node + 1 },
+        { median + 1, task.end, 2 * task.node + 2 }
+    };
+}
 
-        points_[i] = *(b + d / 2);
+// whole subtree of task on the calling thread
+inline void build_subtree_(std::span<kdtree_entry_> entries, const kdtree_task_& root, std::span<u32> order, std::span<u8> axes) {
+    std::vector<kdtree_task_> stack{root};
+    while(!stack.empty()) {
+        auto task = stack.back();
+        stack.pop_back();
 
-        if(b + d / 2 + 1 != e) {
-            s.push({b + d / 2 + 1, e, h + 1, 2 * i + 2});
+        auto [left, right] = split_task_(entries, task, order, axes);
+        if(right.begin != right.end) {
+            stack.push_back(right);
         }
-        if(b != b + d / 2) {
-            s.push({b, b + d / 2, h + 1, 2 * i + 1});
+        if(left.begin != left.end) {
+            stack.push_back(left);
         }
     }
 }
 
-vec3f32 kdtree::nn_search(const vec3f32& query) const {
-    auto min_d = F32_MAX;
-    vec3f32 result{};
+void kdtree_order_(std::span<const vec3f32> points, std::vector<u32>& order, std::vector<u8>& axes) {
+    // below this many points per subtree, splitting further for threads costs more than it saves
+    constexpr u32 MIN_PARALLEL_SIZE = 1 << 12;
 
-    // (height, index)
-    std::stack<std::pair<u32, u32>> s{};
-    s.push({0, 0});
-
-    while(!s.empty()) {
-        auto [h, i] = s.top();
-        s.pop();
-
-        auto axis = h % 3;
-
-        auto d = distance(query, points_[i]);
-        if(d < min_d) {
-            min_d = d;
-            result = points_[i];
-        }
+    auto size = static_cast<u32>(points.size());
+    order.assign(size, 0);
+    axes.assign(size, 0);
+    if(size == 0) {
+        return;
+    }
 
-        std::cout << std::format("{} = {}, d = {}", i, points_[i], distance(query, points_[i])) << std::endl;
+    // points are partitioned together with their source index, so comparisons touch contiguous memory
+    std::vector<kdtree_entry_> entries(size);
+    for(u32 i = 0; i < size; ++i) {
+        entries[i] = { points[i], i };
+    }
 
-        if(h < height_) {
-            if(query[axis] >= points_[i][axis]) {
-                s.push({h + 1, 2 * i + 2});
+    // top levels on this thread until there are enough independent subtrees for every thread
+    auto thread_count = std::max<u32>(1, std::thread::hardware_concurrency());
+    std::vector<kdtree_task_> tasks{{0, size, 0}};
+    while(tasks.size() < thread_count * 4 && tasks.front().end - tasks.front().begin >= MIN_PARALLEL_SIZE) {
+        std::vector<kdtree_task_> next{};
+        for(const auto& task : tasks) {
+            auto [left, right] = split_task_(entries, task, order, axes);
+            if(left.begin != left.end) {
+                next.push_back(left);
             }
-            if(query[axis] <= points_[i][axis]) {
-                s.push({h + 1, 2 * i + 1});
+            if(right.begin != right.end) {
+                next.push_back(right);
             }
         }
+        tasks = std::move(next);
+    }
+
+    // remaining subtrees do not overlap in entries or nodes
+    std::atomic<u32> next{};
+    std::vector<std::thread> threads{};
+    for(u32 t = 0; t < std::min<u32>(thread_count, tasks.size()); ++t) {
+        threads.emplace_back([&] {
+            for(auto i = next++; i < tasks.size(); i = next++) {
+                build_subtree_(entries, tasks[i], order, axes);
+            }
+        });
     }
+    for(auto& t : threads) {
+        t.join();
+    }
+}
 
-    return result;
 }
 
 }
\ No newline at end of file
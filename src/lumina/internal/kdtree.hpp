@@ -1,7 +1,11 @@
 #pragma once
 
 #include <algorithm>
-#include <stack>
+#include <array>
+#include <concepts>
+#include <numeric>
+#include <optional>
+#include <span>
 #include <vector>
 
 #include "vector.hpp"
@@ -9,16 +13,167 @@
 
 namespace lumina {
 
+// result of kdtree queries
+template<class Payload>
+struct kdtree_neighbor {
+    // record stored with the point in the tree
+    const Payload* payload;
+    f32 distance2;
+};
+
+namespace internal_ {
+
+// node order of a left-balanced kdtree over points: order[node] = index of the point
+// node i has children 2i+1 and 2i+2 (if < size), splitting axis of node i is axes[i]
+// subtrees are built on all hardware threads
+void kdtree_order_(std::span<const vec3f32> points, std::vector<u32>& order, std::vector<u8>& axes);
+
+}
+
+// 3D tree over points with a Payload record per point, balanced by median splits along the largest extent
+// stored as a left-balanced implicit binary heap of exactly size() nodes (no padding)
+// queries do not allocate, the traversal stack lives on the call stack
+// reference: Henrik Wann Jensen - "Realistic Image Synthesis Using Photon Mapping", 2001 (balanced kd-tree)
+template<class Payload = u32>
 class kdtree {
-    static constexpr vec3f32 SENTRY_ = vec3f32(F32_MAX);
+    // pending subtrees of a query, tree height is below 32 for u32 point counts
+    static constexpr u32 STACK_SIZE_ = 64;
+
+    // (node, squared distance from the query to the region of the node)
+    struct stack_entry_ {
+        u32 index;
+        f32 distance2;
+    };
 
     std::vector<vec3f32> points_;
-    u32 height_;
+    std::vector<Payload> payloads_;
+    std::vector<u8> axes_;
+
+    // calls visit(node, squared distance) for nodes whose region is within max_distance2(), in near-first order
+    // max_distance2() is re-read after every visit, so the search radius may shrink while searching
+    template<class MaxDistance2, class Visit>
+    void traverse_(const vec3f32& query, MaxDistance2&& max_distance2, Visit&& visit) const {
+        if(points_.empty()) {
+            return;
+        }
+
+        auto size = static_cast<u32>(points_.size());
+        std::array<stack_entry_, STACK_SIZE_> stack{};
+        u32 top{};
+        stack[top++] = { 0, 0.0f };
+
+        while(top > 0) {
+            auto [i, bound] = stack[--top];
+            // region of node is farther than the current radius
+            if(bound > max_distance2()) {
+                continue;
+            }
+
+            const auto& p = points_[i];
+            auto d = p - query;
+            visit(i, dot(d, d));
+
+            auto left = 2 * i + 1;
+            if(left < size) {
+                auto axis = axes_[i];
+                auto diff = query[axis] - p[axis];
+                auto near = diff < 0.0f ? left : left + 1;
+                auto far = diff < 0.0f ? left + 1 : left;
+                // far child first, near child is popped next
+                if(far < size) {
+                    stack[top++] = { far, std::max(bound, diff * diff) };
+                }
+                if(near < size) {
+                    stack[top++] = { near, bound };
+                }
+            }
+        }
+    }
 
 public:
-    kdtree(std::vector<vec3f32> src);
+    // payload of every point is its index in points
+    explicit kdtree(std::span<const vec3f32> points) requires std::same_as<Payload, u32> : kdtree(points, [&] {
+        std::vector<u32> indices(points.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        return indices;
+    }()) {}
+
+    // payloads[i] belongs to points[i]
+    kdtree(std::span<const vec3f32> points, std::vector<Payload> payloads) {
+        std::vector<u32> order{};
+        internal_::kdtree_order_(points, order, axes_);
+
+        points_.resize(order.size());
+        payloads_.reserve(order.size());
+        for(usize i = 0; i < order.size(); ++i) {
+            points_[i] = points[order[i]];
+            payloads_.push_back(std::move(payloads[order[i]]));
+        }
+    }
+
+    // nearest point, std::nullopt for an empty tree
+    std::optional<kdtree_neighbor<Payload>> nn_search(const vec3f32& query) const {
+        auto nearest = U32_MAX;
+        auto nearest_distance2 = F32_MAX;
+        traverse_(query, [&] { return nearest_distance2; }, [&](u32 i, f32 distance2) {
+            if(distance2 < nearest_distance2) {
+                nearest_distance2 = distance2;
+                nearest = i;
+            }
+        });
+        if(nearest == U32_MAX) {
+            return std::nullopt;
+        }
+        return kdtree_neighbor<Payload>{ &payloads_[nearest], nearest_distance2 };
+    }
+
+    // up to result.size() nearest points within max_distance, sorted by distance
+    // result is the bounded max-heap used while searching, returns the filled part of it
+    std::span<kdtree_neighbor<Payload>> knn_search(const vec3f32& query, std::span<kdtree_neighbor<Payload>> result, f32 max_distance = F32_MAX) const {
+        if(result.empty()) {
+            return result.first(0);
+        }
+
+        auto farther = [](const kdtree_neighbor<Payload>& a, const kdtree_neighbor<Payload>& b) { return a.distance2 < b.distance2; };
+        auto limit2 = max_distance < F32_MAX ? max_distance * max_distance : F32_MAX;
+        size_t count{};
+
+        // radius is the farthest found neighbour once the heap is full
+        auto max_distance2 = [&] { return count == result.size() ? result[0].distance2 : limit2; };
+        traverse_(query, max_distance2, [&](u32 i, f32 distance2) {
+            if(distance2 > max_distance2()) {
+                return;
+            }
+            if(count == result.size()) {
+                std::pop_heap(result.begin(), result.end(), farther);
+                result[count - 1] = { &payloads_[i], distance2 };
+            }
+            else {
+                result[count++] = { &payloads_[i], distance2 };
+            }
+            std::push_heap(result.begin(), result.begin() + count, farther);
+        });
+
+        std::sort_heap(result.begin(), result.begin() + count, farther);
+        return result.first(count);
+    }
+
+    // calls f(payload, squared distance) for every point within radius (unordered)
+    template<class F>
+    void radius_search(const vec3f32& query, f32 radius, F&& f) const {
+        auto radius2 = radius * radius;
+        traverse_(query, [radius2] { return radius2; }, [&](u32 i, f32 distance2) {
+            if(distance2 <= radius2) {
+                f(payloads_[i], distance2);
+            }
+        });
+    }
+
+    usize size() const noexcept { return points_.size(); }
 
-    vec3f32 nn_search(const vec3f32& query) const;
+    usize resident_bytes() const noexcept {
+        return points_.size() * sizeof(vec3f32) + payloads_.size() * sizeof(Payload) + axes_.size() * sizeof(u8);
+    }
 };
 
 }
\ No newline at end of file
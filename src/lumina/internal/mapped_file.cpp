@@ -0,0 +1,157 @@
+#include "mapped_file.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lumina {
+
+#if defined(_WIN32)
+
+mapped_file::mapped_file() noexcept : data_(nullptr), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(nullptr) {}
+
+mapped_file::mapped_file(const char* path) : data_(nullptr), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(nullptr) {
+    file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file_ == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER size{};
+    if(!GetFileSizeEx(file_, &size)) {
+        release_();
+        return;
+    }
+    size_ = static_cast<usize>(size.QuadPart);
+
+    // empty file cannot be mapped
+    if(size_ == 0) {
+        return;
+    }
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mapping_) {
+        release_();
+        return;
+    }
+
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if(!data_) {
+        release_();
+    }
+}
+
+void mapped_file::release_() noexcept {
+    if(data_) {
+        UnmapViewOfFile(data_);
+    }
+    if(mapping_) {
+        CloseHandle(mapping_);
+    }
+    if(file_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept : data_(other.data_), size_(other.size_), file_(other.file_), mapping_(other.mapping_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.file_ = INVALID_HANDLE_VALUE;
+    other.mapping_ = nullptr;
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+    if(this != &other) {
+        release_();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+    }
+    return *this;
+}
+
+bool mapped_file::is_valid() const noexcept {
+    return file_ != INVALID_HANDLE_VALUE;
+}
+
+#else
+
+mapped_file::mapped_file() noexcept : data_(nullptr), size_(0), fd_(-1) {}
+
+mapped_file::mapped_file(const char* path) : data_(nullptr), size_(0), fd_(-1) {
+    fd_ = ::open(path, O_RDONLY);
+    if(fd_ < 0) {
+        return;
+    }
+
+    struct stat st{};
+    if(::fstat(fd_, &st) != 0) {
+        release_();
+        return;
+    }
+    size_ = static_cast<usize>(st.st_size);
+
+    // empty file cannot be mapped
+    if(size_ == 0) {
+        return;
+    }
+
+    auto p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if(p == MAP_FAILED) {
+        release_();
+        return;
+    }
+    ::madvise(p, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(p);
+}
+
+void mapped_file::release_() noexcept {
+    if(data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    if(fd_ >= 0) {
+        ::close(fd_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    fd_ = -1;
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept : data_(other.data_), size_(other.size_), fd_(other.fd_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.fd_ = -1;
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+    if(this != &other) {
+        release_();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(fd_, other.fd_);
+    }
+    return *this;
+}
+
+bool mapped_file::is_valid() const noexcept {
+    return fd_ >= 0;
+}
+
+#endif
+
+mapped_file::~mapped_file() {
+    release_();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <utility>
+
+#include "base.hpp"
+
+namespace lumina {
+
+// read-only memory mapping of whole file
+// invalid (operator bool() == false) if the file could not be opened or mapped
+class mapped_file {
+    const char* data_;
+    usize size_;
+#if defined(_WIN32)
+    void* file_;
+    void* mapping_;
+#else
+    int fd_;
+#endif
+
+    void release_() noexcept;
+
+public:
+    // empty mapping
+    mapped_file() noexcept;
+    explicit mapped_file(const char* path);
+    ~mapped_file();
+
+    // forbid copy
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+
+    const char* data() const noexcept { return data_; }
+    usize size() const noexcept { return size_; }
+
+    // empty file is valid but has no data
+    bool is_valid() const noexcept;
+    explicit operator bool() const noexcept { return is_valid(); }
+};
+
+}
\ No newline at end of file
@@ -7,15 +7,35 @@
 
 namespace lumina {
 
+// scattering model of material (see bsdf.hpp)
+enum class material_type {
+    // Lambertian reflection, roughness is ignored
+    diffuse,
+    // GGX reflection, albedo is used as F0 of Schlick's approximation
+    conductor,
+    // GGX reflection and refraction with refractive_index (ref_idx constants), albedo tints transmission
+    dielectric,
+};
+
+constexpr const char* to_string(material_type t) noexcept {
+    switch(t) {
+        case material_type::diffuse:    return "diffuse";
+        case material_type::conductor:  return "conductor";
+        case material_type::dielectric: return "dielectric";
+    }
+    return "unknown";
+}
+
 struct material {
     vec3f32 albedo;
     vec3f32 emission;
     f32 roughness;
     f32 refractive_index;
+    material_type type = material_type::conductor;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const material& m) {
-    os << std::format("albedo: {}, emission: {}, roughness: {}, refractive index: {}", m.albedo, m.emission, m.roughness, m.refractive_index);
+    os << std::format("albedo: {}, emission: {}, roughness: {}, refractive index: {}, type: {}", m.albedo, m.emission, m.roughness, m.refractive_index, to_string(m.type));
     return os;
 }
 
@@ -29,6 +49,6 @@ struct std::formatter<lumina::material> {
     }
 
     auto format(const lumina::material& m , std::format_context& ctx) const {
-        return std::format_to(ctx.out(), "albedo: {}, emission: {}, roughness: {}, refractive index: {}", m.albedo, m.emission, m.roughness, m.refractive_index);
+        return std::format_to(ctx.out(), "albedo: {}, emission: {}, roughness: {}, refractive index: {}, type: {}", m.albedo, m.emission, m.roughness, m.refractive_index, to_string(m.type));
     }
 };
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "memory.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+// GetProcessMemoryInfo() -> K32GetProcessMemoryInfo() in kernel32, no psapi.lib
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cstdio>
+
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace lumina {
+
+#if defined(_WIN32)
+
+std::optional<usize> current_resident_bytes() {
+    PROCESS_MEMORY_COUNTERS counters{};
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return std::nullopt;
+    }
+    return counters.WorkingSetSize;
+}
+
+std::optional<usize> peak_resident_bytes() {
+    PROCESS_MEMORY_COUNTERS counters{};
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return std::nullopt;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+#else
+
+std::optional<usize> current_resident_bytes() {
+#if defined(__linux__)
+    // (total pages, resident pages, ...)
+    std::FILE* fp = std::fopen("/proc/self/statm", "r");
+    if(!fp) {
+        return std::nullopt;
+    }
+    unsigned long total{};
+    unsigned long resident{};
+    auto read = std::fscanf(fp, "%lu %lu", &total, &resident);
+    std::fclose(fp);
+    if(read != 2) {
+        return std::nullopt;
+    }
+    return static_cast<usize>(resident) * static_cast<usize>(sysconf(_SC_PAGESIZE));
+#else
+    return std::nullopt;
+#endif
+}
+
+std::optional<usize> peak_resident_bytes() {
+    rusage usage{};
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return std::nullopt;
+    }
+#if defined(__APPLE__)
+    // bytes on macOS
+    return static_cast<usize>(usage.ru_maxrss);
+#else
+    // kilobytes on Linux
+    return static_cast<usize>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+#endif
+
+}
\ No newline at end of file
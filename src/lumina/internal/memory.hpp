@@ -0,0 +1,14 @@
+#pragma once
+
+#include <optional>
+
+#include "base.hpp"
+
+namespace lumina {
+
+// resident set size (physical memory) of this process in bytes
+// std::nullopt if the platform does not report it
+std::optional<usize> current_resident_bytes();
+std::optional<usize> peak_resident_bytes();
+
+}
\ No newline at end of file
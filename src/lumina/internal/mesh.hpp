@@ -1,70 +1,271 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
+#include "mapped_file.hpp"
 #include "material.hpp"
+#include "obj.hpp"
 
 namespace lumina {
 
-struct mesh {
+namespace internal_ {
+
+// vertex arrays and single index buffer from separate position / texcoord / normal indices
+struct unified_vertices_ {
     std::vector<vec3f32> vertices;
     std::vector<vec2f32> texcoords;
     std::vector<vec3f32> normals;
+    std::vector<vec3u32> indices;
+};
+
+// corners with the same (position, texcoord, normal) triple share one vertex, so a position is duplicated only on attribute seams
+// corners without texcoords / normals get (0, 0) / zero normal, arrays of attributes no polygon has stay empty
+// source arrays are consumed: vertex_indices becomes the unified index buffer in place, the others are released as soon as they are read
+// so the peak is the source arrays plus one u32 per unified vertex and attribute, not a second copy of the geometry
+inline unified_vertices_ unify_vertices_(
+    std::vector<vec3f32>&& vertices,
+    std::vector<vec2f32>&& texcoords,
+    std::vector<vec3f32>&& normals,
+    std::vector<vec3u32>&& vertex_indices,
+    std::vector<vec3u32>&& texcoord_indices,
+    std::vector<vec3u32>&& normal_indices
+) {
+    auto has_texcoords = std::any_of(texcoord_indices.begin(), texcoord_indices.end(), [](const auto& t) { return t.x != INVALID_INDEX; });
+    auto has_normals = std::any_of(normal_indices.begin(), normal_indices.end(), [](const auto& n) { return n.x != INVALID_INDEX; });
+
+    // unified vertex -> source position / texcoord / normal index
+    std::vector<u32> position_of{};
+    std::vector<u32> texcoord_of{};
+    std::vector<u32> normal_of{};
+    position_of.reserve(vertices.size());
+    texcoord_of.reserve(vertices.size());
+    normal_of.reserve(vertices.size());
+
+    {
+        // unified vertices sharing a position are chained from head[position]
+        std::vector<u32> head(vertices.size(), INVALID_INDEX);
+        std::vector<u32> next{};
+        next.reserve(vertices.size());
+
+        for(size_t i = 0; i < vertex_indices.size(); ++i) {
+            for(size_t k = 0; k < 3; ++k) {
+                auto v = vertex_indices[i][k];
+                auto t = has_texcoords ? texcoord_indices[i][k] : INVALID_INDEX;
+                auto n = has_normals ? normal_indices[i][k] : INVALID_INDEX;
+
+                auto u = head[v];
+                while(u != INVALID_INDEX && (texcoord_of[u] != t || normal_of[u] != n)) {
+                    u = next[u];
+                }
+
+                if(u == INVALID_INDEX) {
+                    u = static_cast<u32>(position_of.size());
+                    position_of.push_back(v);
+                    texcoord_of.push_back(t);
+                    normal_of.push_back(n);
+                    next.push_back(head[v]);
+                    head[v] = u;
+                }
+
+                vertex_indices[i][k] = u;
+            }
+        }
+    }
+    texcoord_indices = {};
+    normal_indices = {};
+
+    // one attribute at a time: source[of[u]] for every unified vertex u, then source and map are released
+    auto gather = []<class T>(std::vector<T>& source, std::vector<u32>& of, const T& fallback) {
+        std::vector<T> result(of.size());
+        for(size_t u = 0; u < of.size(); ++u) {
+            result[u] = of[u] != INVALID_INDEX ? source[of[u]] : fallback;
+        }
+        source = {};
+        of = {};
+        return result;
+    };
+
+    unified_vertices_ result{};
+    result.vertices = gather(vertices, position_of, vec3f32(0.0f));
+    if(has_texcoords) {
+        result.texcoords = gather(texcoords, texcoord_of, vec2f32(0.0f));
+    }
+    if(has_normals) {
+        result.normals = gather(normals, normal_of, vec3f32(0.0f));
+    }
+    texcoords = {};
+    normals = {};
+    result.indices = std::move(vertex_indices);
 
-    // required in .obj file
-    std::vector<vec3u32> vertex_indices;
-    // some polygons may have no texcoords or completely empty
-    std::vector<std::optional<vec3u32>> texcoord_indices;
-    // all polygons should have its normal but could be empty
-    std::vector<std::optional<vec3u32>> normal_indices;
+    return result;
+}
+
+}
+
+// geometry arrays of mesh
+struct mesh_views {
+    std::span<const vec3f32> vertices;
+    std::span<const vec2f32> texcoords;
+    std::span<const vec3f32> normals;
+    std::span<const vec3u32> vertex_indices;
+    std::span<const u32> group_indices;
+    std::span<const vec4f32> bary_dots;
+};
+
+struct mesh {
+    // geometry is a view of memory owned by the mesh (vectors or mapped binary file, see mesh_binary.hpp)
+    // attributes are per vertex (structure of arrays) and share vertex_indices
+    std::span<const vec3f32> vertices;
+    // empty if no polygon has texcoords, (0, 0) for vertices of polygons without them
+    std::span<const vec2f32> texcoords;
+    // empty if no polygon has normals, zero vector for vertices of polygons without them
+    std::span<const vec3f32> normals;
+
+    // single index buffer for all attributes
+    std::span<const vec3u32> vertex_indices;
+
+    // polygon -> group index (material ID)
+    std::span<const u32> group_indices;
+    // group index -> group name
+    std::vector<std::string> group_names;
 
     // group name -> polygon count
     std::unordered_map<std::string, u32> mesh_groups;
     // group name -> material information
-    std::unordered_map<std::string, material> mat_info;
+    std::unordered_map<std::string, lumina::material> mat_info;
 
     // precomputed dot products to calculate barycentric coordinates
     // (d00, d01, d11, denominator)
-    std::vector<vec4f32> bary_dots;
+    std::span<const vec4f32> bary_dots;
+
+private:
+    // group index -> material information
+    std::vector<lumina::material> materials_;
+
+    // storage of mesh built in memory
+    std::vector<vec3f32> vertices_;
+    std::vector<vec2f32> texcoords_;
+    std::vector<vec3f32> normals_;
+    std::vector<vec3u32> vertex_indices_;
+    std::vector<u32> group_indices_;
+    std::vector<vec4f32> bary_dots_;
 
+    // storage of mesh mapped from binary file
+    mapped_file file_;
+
+    void set_views_(const mesh_views& views) noexcept {
+        vertices = views.vertices;
+        texcoords = views.texcoords;
+        normals = views.normals;
+        vertex_indices = views.vertex_indices;
+        group_indices = views.group_indices;
+        bary_dots = views.bary_dots;
+    }
+
+    void init_materials_() {
+        for(const auto& name : group_names) {
+            mat_info[name] = lumina::material{};
+        }
+        materials_.assign(group_names.size(), lumina::material{});
+    }
+
+public:
     // forbid default construction
     mesh() = delete;
 
+    // arrays are moved in, never copied
+    // texcoord / normal indices of polygons without the attribute are INVALID_INDEX, attribute indices are unified into vertex_indices
     explicit mesh(
         std::vector<vec3f32>&& vertices,
         std::vector<vec2f32>&& texcoords,
         std::vector<vec3f32>&& normals,
         std::vector<vec3u32>&& vertex_indices,
-        std::vector<std::optional<vec3u32>>&& texcoord_indices,
-        std::vector<std::optional<vec3u32>>&& normal_indices,
-        std::unordered_map<std::string, u32> mesh_groups
-    ) noexcept :
-        vertices(vertices),
-        texcoords(texcoords),
-        normals(normals),
-        vertex_indices(vertex_indices),
-        texcoord_indices(texcoord_indices),
-        normal_indices(normal_indices),
-        mesh_groups(mesh_groups),
+        std::vector<vec3u32>&& texcoord_indices,
+        std::vector<vec3u32>&& normal_indices,
+        group_runs&& mesh_groups
+    ) :
         mat_info(),
-        bary_dots(vertex_indices.size())
+        file_()
     {
-        for(size_t i = 0; i < vertex_indices.size(); ++i) {
-            auto index = vertex_indices[i];
-            auto v0 = vertices[index.y] - vertices[index.x];
-            auto v1 = vertices[index.z] - vertices[index.x];
+        {
+            // source arrays are consumed and released while the unified ones are built
+            auto unified = internal_::unify_vertices_(std::move(vertices), std::move(texcoords), std::move(normals), std::move(vertex_indices), std::move(texcoord_indices), std::move(normal_indices));
+            vertices_ = std::move(unified.vertices);
+            texcoords_ = std::move(unified.texcoords);
+            normals_ = std::move(unified.normals);
+            vertex_indices_ = std::move(unified.indices);
+        }
+
+        group_indices_.resize(vertex_indices_.size());
+        bary_dots_.resize(vertex_indices_.size());
+
+        for(size_t i = 0; i < vertex_indices_.size(); ++i) {
+            auto index = vertex_indices_[i];
+            auto v0 = vertices_[index.y] - vertices_[index.x];
+            auto v1 = vertices_[index.z] - vertices_[index.x];
             auto d00 = dot(v0, v0);
             auto d01 = dot(v0, v1);
             auto d11 = dot(v1, v1);
             auto denominator = d00 * d11 - d01 * d01;
 
-            bary_dots[i] = vec4f32(d00, d01, d11, denominator);
+            bary_dots_[i] = vec4f32(d00, d01, d11, denominator);
         }
 
-        for(const auto& [name, range] : mesh_groups) {
-            mat_info[name] = lumina::material{};
+        // group runs -> group index of each polygon (same name shares index)
+        u32 first{};
+        for(const auto& [name, count] : mesh_groups) {
+            auto it = std::find(group_names.begin(), group_names.end(), name);
+            auto group_index = static_cast<u32>(std::distance(group_names.begin(), it));
+            if(it == group_names.end()) {
+                group_names.push_back(name);
+            }
+
+            std::fill_n(group_indices_.begin() + first, count, group_index);
+            this->mesh_groups[name] += count;
+            first += count;
+        }
+
+        init_materials_();
+        set_views_({vertices_, texcoords_, normals_, vertex_indices_, group_indices_, bary_dots_});
+    }
+
+    // takes the result of load_obj() / load_obj_parallel() as is
+    // e.g. mesh mesh(load_obj_parallel(path));
+    explicit mesh(obj_contents&& contents) :
+        mesh(
+            std::move(std::get<0>(contents)),
+            std::move(std::get<1>(contents)),
+            std::move(std::get<2>(contents)),
+            std::move(std::get<3>(contents)),
+            std::move(std::get<4>(contents)),
+            std::move(std::get<5>(contents)),
+            std::move(std::get<6>(contents))
+        )
+    {}
+
+    // zero-copy construction over mapped binary file (see mesh_binary.hpp)
+    // group_counts: polygon count of each group index
+    explicit mesh(
+        mapped_file&& file,
+        const mesh_views& views,
+        std::vector<std::string>&& group_names,
+        const std::vector<u32>& group_counts
+    ) :
+        group_names(std::move(group_names)),
+        mat_info(),
+        file_(std::move(file))
+    {
+        for(size_t i = 0; i < this->group_names.size(); ++i) {
+            mesh_groups[this->group_names[i]] = group_counts[i];
         }
+
+        init_materials_();
+        set_views_(views);
     }
 
     // forbid copy
@@ -73,9 +274,14 @@ struct mesh {
     mesh(mesh&&) = default;
     mesh& operator=(mesh&&) = default;
 
-    bool add_material(const std::string& name, const material& material) {
+    bool add_material(const std::string& name, const lumina::material& material) {
         if(mesh_groups.contains(name)) {
             mat_info[name] = material;
+            for(size_t i = 0; i < group_names.size(); ++i) {
+                if(group_names[i] == name) {
+                    materials_[i] = material;
+                }
+            }
             return true;
         }
         else {
@@ -83,8 +289,91 @@ struct mesh {
         }
     }
 
+    // already in order: polygons in the given order and vertices numbered by first use (nothing for reorder_polygons() to do)
+    bool is_ordered(std::span<const u32> order) const noexcept {
+        if(order.size() != vertex_indices.size()) {
+            return false;
+        }
+        u32 used{};
+        for(size_t i = 0; i < order.size(); ++i) {
+            if(order[i] != i) {
+                return false;
+            }
+            for(size_t k = 0; k < 3; ++k) {
+                auto v = vertex_indices[i][k];
+                if(v > used) {
+                    return false;
+                }
+                used += v == used ? 1 : 0;
+            }
+        }
+        return used == vertices.size();
+    }
+
+    // polygons are reordered to order[new index] = old index (e.g. leaf order of bvh::reorder())
+    // vertices are renumbered by first use, so neighbouring polygons also share nearby vertices
+    // geometry of a mapped mesh is copied into owned arrays, unless it is already in order (.lmesh written in leaf order by convert_obj_to_binary())
+    void reorder_polygons(std::span<const u32> order) {
+        if(is_ordered(order)) {
+            return;
+        }
+
+        std::vector<vec3u32> vertex_indices_reordered(order.size());
+        std::vector<u32> group_indices_reordered(order.size());
+        std::vector<vec4f32> bary_dots_reordered(order.size());
+
+        std::vector<u32> vertex_map(vertices.size(), INVALID_INDEX);
+        std::vector<u32> vertex_order{};
+        vertex_order.reserve(vertices.size());
+
+        for(size_t i = 0; i < order.size(); ++i) {
+            auto index = vertex_indices[order[i]];
+            for(size_t k = 0; k < 3; ++k) {
+                auto& v = vertex_map[index[k]];
+                if(v == INVALID_INDEX) {
+                    v = static_cast<u32>(vertex_order.size());
+                    vertex_order.push_back(index[k]);
+                }
+                vertex_indices_reordered[i][k] = v;
+            }
+            group_indices_reordered[i] = group_indices[order[i]];
+            bary_dots_reordered[i] = bary_dots[order[i]];
+        }
+
+        auto gather = [&](const auto& source) {
+            std::vector<typename std::remove_cvref_t<decltype(source)>::value_type> result{};
+            if(!source.empty()) {
+                result.reserve(vertex_order.size());
+                for(auto v : vertex_order) {
+                    result.push_back(source[v]);
+                }
+            }
+            return result;
+        };
+        auto vertices_reordered = gather(vertices);
+        auto texcoords_reordered = gather(texcoords);
+        auto normals_reordered = gather(normals);
+
+        vertices_ = std::move(vertices_reordered);
+        texcoords_ = std::move(texcoords_reordered);
+        normals_ = std::move(normals_reordered);
+        vertex_indices_ = std::move(vertex_indices_reordered);
+        group_indices_ = std::move(group_indices_reordered);
+        bary_dots_ = std::move(bary_dots_reordered);
+        file_ = mapped_file();
+
+        set_views_({vertices_, texcoords_, normals_, vertex_indices_, group_indices_, bary_dots_});
+    }
+
+    // bytes of geometry held by this mesh (capacity of owned arrays, or size of mapped file)
+    usize resident_bytes() const noexcept {
+        auto bytes = [](const auto& v) { return v.capacity() * sizeof(v[0]); };
+        return bytes(vertices_) + bytes(texcoords_) + bytes(normals_) + bytes(vertex_indices_) + bytes(group_indices_) + bytes(bary_dots_) + file_.size();
+    }
+
     void statistics() const {
         std::cout << std::format("# of vertices: {}, # of texcoords: {}, # of normals: {}, # of polygons: {}\n", vertices.size(), texcoords.size(), normals.size(), vertex_indices.size());
+        std::cout << std::format("bytes per polygon: {:.1f}\n", f64(resident_bytes()) / f64(std::max<usize>(1, vertex_indices.size())));
         for(const auto& [name, count] : mesh_groups) {
             std::cout << std::format("group name: {}, count {}\n", name, count);
         }
@@ -107,10 +396,9 @@ struct mesh {
         auto w = (bary_dots[index_index].x * d21 - bary_dots[index_index].y * d20) / bary_dots[index_index].w;
         auto u = 1.0f - v - w;
 
-        // polygon has texcoords -> interpolate vertex texcoords
-        if(texcoord_indices[index_index]) {
-            const auto& texcoord_index = *texcoord_indices[index_index];
-            return u * texcoords[texcoord_index.x] + v * texcoords[texcoord_index.y] + w * texcoords[texcoord_index.z];
+        // mesh has texcoords -> interpolate vertex texcoords
+        if(!texcoords.empty()) {
+            return u * texcoords[vertex_index.x] + v * texcoords[vertex_index.y] + w * texcoords[vertex_index.z];
         }
         // otherwise -> return (u, v) as texcoords (meaningless)
         else {
@@ -123,8 +411,8 @@ struct mesh {
         auto v0 = vertices[vertex_index.y] - vertices[vertex_index.x];
         auto v1 = vertices[vertex_index.z] - vertices[vertex_index.x];
 
-        // polygon has normals -> calculate barycentric coordinate and interpolate vertex normals
-        if(normal_indices[index_index]) {
+        // mesh has normals -> calculate barycentric coordinate and interpolate vertex normals
+        if(!normals.empty()) {
             auto v2 = p - vertices[vertex_index.x];
             auto d20 = dot(v2, v0);
             auto d21 = dot(v2, v1);
@@ -133,27 +421,20 @@ struct mesh {
             auto w = (bary_dots[index_index].x * d21 - bary_dots[index_index].y * d20) / bary_dots[index_index].w;
             auto u = 1.0f - v - w;
 
-            const auto& normal_index = *normal_indices[index_index];
+            auto n = u * normals[vertex_index.x] + v * normals[vertex_index.y] + w * normals[vertex_index.z];
 
-            return normalize(u * normals[normal_index.x] + v * normals[normal_index.y] + w * normals[normal_index.z]);
+            // zero -> polygon has no normals
+            if(dot(n, n) > 0.0f) {
+                return normalize(n);
+            }
         }
+
         // otherwise -> calculate normal from triangle
-        else {
-            return normalize(cross(v0, v1));
-        }
+        return normalize(cross(v0, v1));
     }
 
-    material material(u32 index_index) const {
-        for(const auto& [name, count] : mesh_groups) {
-            if(index_index < count) {
-                return mat_info.at(name);
-            }
-            else {
-                index_index -= count;
-            }
-        }
-
-        return lumina::material{};
+    const lumina::material& material(u32 index_index) const {
+        return materials_[group_indices[index_index]];
     }
 };
 
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <type_traits>
+
+#include "mapped_file.hpp"
+#include "mesh_binary.hpp"
+#include "obj.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+constexpr std::array<char, 8> MESH_BINARY_MAGIC_ = {'L', 'U', 'M', 'I', 'N', 'A', 'M', 'S'};
+// written as native u32, reads differently on a machine of the other endianness
+constexpr u32 MESH_BINARY_BYTE_ORDER_ = 0x01020304u;
+
+constexpr auto MESH_SECTION_COUNT_ = static_cast<u32>(mesh_section::count);
+
+struct mesh_binary_header_ {
+    std::array<char, 8> magic;
+    u32 version;
+    u32 byte_order;
+    u32 section_count;
+    u32 reserved;
+    // source file at conversion (source_stamp_), both 0 if converted without one
+    u64 source_size;
+    s64 source_time;
+};
+
+// size and modification time (ns since the file clock epoch) of a file, cheap to compare at every load unlike a content hash
+struct source_stamp_ {
+    u64 size;
+    s64 time;
+
+    bool operator==(const source_stamp_&) const = default;
+};
+
+inline std::optional<source_stamp_> source_stamp_of_(const char* path) {
+    std::error_code error{};
+    auto size = std::filesystem::file_size(path, error);
+    if(error) {
+        return std::nullopt;
+    }
+    auto time = std::filesystem::last_write_time(path, error);
+    if(error) {
+        return std::nullopt;
+    }
+    return source_stamp_{ size, static_cast<s64>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count()) };
+}
+
+struct mesh_binary_section_ {
+    u64 offset;
+    u64 count;
+    u32 element_size;
+    u32 reserved;
+};
+
+// bytes and element size of one section to write
+struct section_source_ {
+    const void* data;
+    u64 count;
+    u32 element_size;
+};
+
+template<class T>
+section_source_ section_of_(std::span<const T> s) {
+    static_assert(std::is_trivially_copyable_v<T>, "mesh sections are written and mapped as raw bytes");
+    return { s.data(), s.size(), sizeof(T) };
+}
+
+constexpr u64 align_up_(u64 offset) noexcept {
+    return (offset + MESH_BINARY_ALIGNMENT - 1) / MESH_BINARY_ALIGNMENT * MESH_BINARY_ALIGNMENT;
+}
+
+// typed view of section, empty if the section does not match T or does not fit in the file
+template<class T>
+std::optional<std::span<const T>> view_of_(const mapped_file& file, const mesh_binary_section_& section) {
+    if(section.element_size != sizeof(T) || section.offset % MESH_BINARY_ALIGNMENT != 0) {
+        return std::nullopt;
+    }
+    if(section.offset > file.size() || section.count > (file.size() - section.offset) / sizeof(T)) {
+        return std::nullopt;
+    }
+
+    // sections are aligned in the file and the mapping is page aligned
+    return std::span<const T>(reinterpret_cast<const T*>(file.data() + section.offset), section.count);
+}
+
+}
+
+void save_mesh_binary(const char* path, const mesh& mesh, const char* source_path) {
+    // group table
+    std::vector<u32> group_counts{};
+    std::vector<u32> group_name_offsets{0};
+    std::vector<char> group_names{};
+    for(const auto& name : mesh.group_names) {
+        group_counts.push_back(mesh.mesh_groups.at(name));
+        group_names.insert(group_names.end(), name.begin(), name.end());
+        group_name_offsets.push_back(static_cast<u32>(group_names.size()));
+    }
+
+    // same order as mesh_section
+    std::array<internal_::section_source_, internal_::MESH_SECTION_COUNT_> sources = {
+        internal_::section_of_(mesh.vertices),
+        internal_::section_of_(mesh.texcoords),
+        internal_::section_of_(mesh.normals),
+        internal_::section_of_(mesh.vertex_indices),
+        internal_::section_of_(mesh.group_indices),
+        internal_::section_of_(mesh.bary_dots),
+        internal_::section_of_(std::span<const u32>(group_counts)),
+        internal_::section_of_(std::span<const u32>(group_name_offsets)),
+        internal_::section_of_(std::span<const char>(group_names)),
+    };
+
+    auto source = source_path ? internal_::source_stamp_of_(source_path) : std::nullopt;
+
+    internal_::mesh_binary_header_ header{
+        .magic = internal_::MESH_BINARY_MAGIC_,
+        .version = MESH_BINARY_VERSION,
+        .byte_order = internal_::MESH_BINARY_BYTE_ORDER_,
+        .section_count = internal_::MESH_SECTION_COUNT_,
+        .reserved = 0,
+        .source_size = source ? source->size : 0,
+        .source_time = source ? source->time : 0
+    };
+
+    std::array<internal_::mesh_binary_section_, internal_::MESH_SECTION_COUNT_> sections{};
+    u64 offset = sizeof(header) + sizeof(sections);
+    for(u32 i = 0; i < internal_::MESH_SECTION_COUNT_; ++i) {
+        offset = internal_::align_up_(offset);
+        sections[i] = { .offset = offset, .count = sources[i].count, .element_size = sources[i].element_size, .reserved = 0 };
+        offset += sources[i].count * sources[i].element_size;
+    }
+
+    std::ofstream ofs(path, std::ios::binary);
+    if(ofs.fail()) {
+        std::clog << std::format("failed to create file: {}. exit.", path) << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(sections.data()), sizeof(sections));
+
+    constexpr std::array<char, MESH_BINARY_ALIGNMENT> padding{};
+    u64 position = sizeof(header) + sizeof(sections);
+    for(u32 i = 0; i < internal_::MESH_SECTION_COUNT_; ++i) {
+        ofs.write(padding.data(), static_cast<std::streamsize>(sections[i].offset - position));
+        auto bytes = sources[i].count * sources[i].element_size;
+        ofs.write(static_cast<const char*>(sources[i].data), static_cast<std::streamsize>(bytes));
+        position = sections[i].offset + bytes;
+    }
+
+    if(ofs.fail()) {
+        std::clog << std::format("failed to write file: {}. exit.", path) << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+std::optional<mesh> load_mesh_binary(const char* path, const char* source_path) {
+    mapped_file file(path);
+    if(!file) {
+        return std::nullopt;
+    }
+
+    internal_::mesh_binary_header_ header{};
+    std::array<internal_::mesh_binary_section_, internal_::MESH_SECTION_COUNT_> sections{};
+    if(file.size() < sizeof(header) + sizeof(sections)) {
+        std::clog << std::format("not a lumina mesh file: {}", path) << std::endl;
+        return std::nullopt;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    std::memcpy(sections.data(), file.data() + sizeof(header), sizeof(sections));
+
+    if(header.magic != internal_::MESH_BINARY_MAGIC_) {
+        std::clog << std::format("not a lumina mesh file: {}", path) << std::endl;
+        return std::nullopt;
+    }
+    if(header.version != MESH_BINARY_VERSION || header.byte_order != internal_::MESH_BINARY_BYTE_ORDER_ || header.section_count != internal_::MESH_SECTION_COUNT_) {
+        std::clog << std::format("incompatible lumina mesh file (version {}, expected {}): {}", header.version, MESH_BINARY_VERSION, path) << std::endl;
+        return std::nullopt;
+    }
+    if(source_path) {
+        auto source = internal_::source_stamp_of_(source_path);
+        if(source && *source != internal_::source_stamp_{ header.source_size, header.source_time }) {
+            std::clog << std::format("lumina mesh file does not match its source {}, ignored: {}", source_path, path) << std::endl;
+            return std::nullopt;
+        }
+    }
+
+    auto section = [&](mesh_section s) -> const internal_::mesh_binary_section_& {
+        return sections[static_cast<u32>(s)];
+    };
+
+    auto vertices = internal_::view_of_<vec3f32>(file, section(mesh_section::vertices));
+    auto texcoords = internal_::view_of_<vec2f32>(file, section(mesh_section::texcoords));
+    auto normals = internal_::view_of_<vec3f32>(file, section(mesh_section::normals));
+    auto vertex_indices = internal_::view_of_<vec3u32>(file, section(mesh_section::vertex_indices));
+    auto group_indices = internal_::view_of_<u32>(file, section(mesh_section::group_indices));
+    auto bary_dots = internal_::view_of_<vec4f32>(file, section(mesh_section::bary_dots));
+    auto group_counts = internal_::view_of_<u32>(file, section(mesh_section::group_counts));
+    auto group_name_offsets = internal_::view_of_<u32>(file, section(mesh_section::group_name_offsets));
+    auto group_names = internal_::view_of_<char>(file, section(mesh_section::group_names));
+
+    if(!vertices || !texcoords || !normals || !vertex_indices || !group_indices || !bary_dots || !group_counts || !group_name_offsets || !group_names) {
+        std::clog << std::format("broken section in lumina mesh file: {}", path) << std::endl;
+        return std::nullopt;
+    }
+
+    auto vertex_count = vertices->size();
+    auto polygon_count = vertex_indices->size();
+    if((!texcoords->empty() && texcoords->size() != vertex_count) || (!normals->empty() && normals->size() != vertex_count) || group_indices->size() != polygon_count || bary_dots->size() != polygon_count || group_name_offsets->size() != group_counts->size() + 1) {
+        std::clog << std::format("inconsistent section sizes in lumina mesh file: {}", path) << std::endl;
+        return std::nullopt;
+    }
+
+    // group table is tiny, only names are copied
+    std::vector<std::string> names{};
+    for(size_t i = 0; i < group_counts->size(); ++i) {
+        auto first = (*group_name_offsets)[i];
+        auto last = (*group_name_offsets)[i + 1];
+        if(first > last || last > group_names->size()) {
+            std::clog << std::format("broken group table in lumina mesh file: {}", path) << std::endl;
+            return std::nullopt;
+        }
+        names.emplace_back(group_names->data() + first, last - first);
+    }
+    std::vector<u32> counts(group_counts->begin(), group_counts->end());
+
+    // mapped values are indexed without checks later (materials, normals, traversal)
+    auto group_count = counts.size();
+    auto valid_indices = std::ranges::all_of(*vertex_indices, [&](const vec3u32& v) {
+        return v.x < vertex_count && v.y < vertex_count && v.z < vertex_count;
+    });
+    auto valid_groups = std::ranges::all_of(*group_indices, [&](u32 g) { return g < group_count; });
+    auto counted = std::accumulate(counts.begin(), counts.end(), u64{});
+    if(!valid_indices || !valid_groups || counted != polygon_count) {
+        std::clog << std::format("broken section in lumina mesh file: {}", path) << std::endl;
+        return std::nullopt;
+    }
+
+    mesh_views views{
+        .vertices = *vertices,
+        .texcoords = *texcoords,
+        .normals = *normals,
+        .vertex_indices = *vertex_indices,
+        .group_indices = *group_indices,
+        .bary_dots = *bary_dots
+    };
+
+    return mesh(std::move(file), views, std::move(names), counts);
+}
+
+void convert_obj_to_binary(const char* obj_path, const char* binary_path, const bvh_options& options) {
+    mesh mesh(load_obj(obj_path));
+    {
+        bvh bvh(mesh.vertices, mesh.vertex_indices, options);
+        mesh.reorder_polygons(bvh.reorder());
+    }
+    save_mesh_binary(binary_path, mesh, obj_path);
+}
+
+}
\ No newline at end of file
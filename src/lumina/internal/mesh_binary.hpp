@@ -0,0 +1,48 @@
+#pragma once
+
+#include <optional>
+
+#include "base.hpp"
+#include "bvh.hpp"
+#include "mesh.hpp"
+
+namespace lumina {
+
+// binary mesh file (.lmesh)
+// header, section table, then one section per array of mesh, each aligned to MESH_BINARY_ALIGNMENT bytes
+// arrays are stored in the in-memory layout of mesh, so loading maps the file and views the sections without parsing or copying
+// the layout is native (endianness), files from a different layout are rejected at load
+// 2: attribute indices unified into vertex_indices
+// 3: size and modification time of the source file in the header
+constexpr u32 MESH_BINARY_VERSION = 3;
+constexpr u64 MESH_BINARY_ALIGNMENT = 64;
+
+enum class mesh_section : u32 {
+    vertices,
+    texcoords,
+    normals,
+    vertex_indices,
+    // polygon -> group index (material ID)
+    group_indices,
+    bary_dots,
+    // group table: polygon count of each group, offsets of names in group_names (group count + 1), name characters
+    group_counts,
+    group_name_offsets,
+    group_names,
+    count
+};
+
+// exits if the file could not be created
+// source_path: file the mesh was converted from, its size and modification time are recorded for load_mesh_binary()
+void save_mesh_binary(const char* path, const mesh& mesh, const char* source_path = nullptr);
+
+// std::nullopt if the file does not exist or is not a valid .lmesh file of this build (including indices out of range)
+// source_path: std::nullopt also if this file exists and changed since the conversion (stale .lmesh)
+std::optional<mesh> load_mesh_binary(const char* path, const char* source_path = nullptr);
+
+// .obj -> .lmesh, built on load_obj()
+// polygons are written in the leaf order of a bvh built with options (bvh::reorder()), so a renderer building the same bvh
+// finds the mapped mesh already in order and mesh::reorder_polygons() keeps it mapped instead of copying it
+void convert_obj_to_binary(const char* obj_path, const char* binary_path, const bvh_options& options = { .split = bvh_split::spatial });
+
+}
\ No newline at end of file
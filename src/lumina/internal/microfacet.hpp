@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <tuple>
+
 #include "sampling.hpp"
 
 namespace lumina {
@@ -29,31 +32,79 @@ inline f32 f(const vec3f32& i, const vec3f32& m, f32 eta_i, f32 eta_o) {
     return 0.5f * ((numerator1 * numerator1) / (denominator1 * denominator1)) * (1.0f + (numerator2 * numerator2) / (denominator2 * denominator2));
 }
 
+// GGX distribution in algebraic form (no inverse trigonometric functions)
+// reference: Eric Heitz - "Understanding the Masking-Shadowing Function in Microfacet-Based BRDFs", 2014
+
+// smallest alpha used for sampling and evaluation, alpha = 0 (perfect mirror) makes D a delta function
+constexpr f32 GGX_MIN_ALPHA = 1.0e-4f;
+
+// surface parameter alpha from roughness
+inline f32 ggx_alpha(f32 roughness) {
+    return std::max(roughness * roughness, GGX_MIN_ALPHA);
+}
+
+// microfacet distribution function D
+// m: microsurface normal, n: macrosurface normal, alpha: surface parameter (usually roughness^2)
+// D(m) = alpha^2 / (pi * (cos^2 * (alpha^2 - 1) + 1)^2)
+inline f32 d(const vec3f32& m, const vec3f32& n, f32 alpha) {
+    auto cos_m = dot(m, n);
+    if(cos_m <= 0.0f) {
+        return 0.0f;
+    }
+
+    auto alpha2 = alpha * alpha;
+    auto t = cos_m * cos_m * (alpha2 - 1.0f) + 1.0f;
+
+    return alpha2 / (F32_PI * t * t);
+}
+
+// Smith auxiliary function Lambda
+// tan^2 = (1 - cos^2) / cos^2
+inline f32 lambda(const vec3f32& v, const vec3f32& n, f32 alpha) {
+    auto cos_v = dot(v, n);
+    auto cos2_v = cos_v * cos_v;
+    if(cos2_v == 0.0f) {
+        return F32_MAX;
+    }
+
+    auto alpha2_tan2 = alpha * alpha * (1.0f - cos2_v) / cos2_v;
+
+    return 0.5f * (std::sqrt(1.0f + alpha2_tan2) - 1.0f);
+}
+
 // shadowing-masking function G
+// Smith masking function for single direction
 inline f32 g1(const vec3f32& v, const vec3f32& m, const vec3f32& n, f32 alpha) {
-    auto theta_v = std::acos(dot(v, n));
-
-    auto coef = std::max(0.0f, dot(v, m) / dot(v, n));
-    auto denominator = 1.0f + std::sqrt(1.0f + alpha * alpha * std::tan(theta_v) * std::tan(theta_v));
+    if(dot(v, m) * dot(v, n) <= 0.0f) {
+        return 0.0f;
+    }
 
-    return coef * (2.0f / denominator);
+    return 1.0f / (1.0f + lambda(v, n, alpha));
 }
 
+// separable (uncorrelated) masking-shadowing
 inline f32 g(const vec3f32& i, const vec3f32& o, const vec3f32& m, const vec3f32& n, f32 alpha) {
     return g1(i, m, n, alpha) * g1(o, m, n, alpha);
 }
 
-// microfacet distribution function D
-// m: microsurface normal, n: macrosurface normal, alpha: surface parameter (usually roughness^2)
-inline f32 d(const vec3f32& m, const vec3f32& n, f32 alpha) {
-    auto theta_m = std::acos(dot(m, n));
+// height-correlated masking-shadowing
+inline f32 g2(const vec3f32& i, const vec3f32& o, const vec3f32& m, const vec3f32& n, f32 alpha) {
+    if(dot(i, m) * dot(i, n) <= 0.0f || dot(o, m) * dot(o, n) <= 0.0f) {
+        return 0.0f;
+    }
 
-    auto numerator = alpha * alpha * std::max(0.0f, dot(m, n));
-    auto denominator1 = F32_PI * std::pow(std::cos(theta_m), 4.0f);
-    auto denominator2 = (alpha * alpha + std::tan(theta_m) * std::tan(theta_m));
+    return 1.0f / (1.0f + lambda(i, n, alpha) + lambda(o, n, alpha));
+}
+
+// distribution of visible normals D_v(m) = G1(v, m) * max(0, v.m) * D(m) / (v.n)
+inline f32 d_visible(const vec3f32& v, const vec3f32& m, const vec3f32& n, f32 alpha) {
+    auto cos_v = dot(v, n);
+    if(cos_v <= 0.0f) {
+        return 0.0f;
+    }
 
-    return numerator / (denominator1 * (denominator2 * denominator2));
-} 
+    return g1(v, m, n, alpha) * std::max(0.0f, dot(v, m)) * d(m, n, alpha) / cos_v;
+}
 
 // F(i, h)
 // G(i, o, h)
@@ -61,51 +112,81 @@ inline f32 d(const vec3f32& m, const vec3f32& n, f32 alpha) {
 
 // i: incoming ray (surface -> light)
 // o: outgoing ray (surface -> eye)
+// n: macrosurface normal on the side of o
+// eta: relative index of refraction (inside of n / outside of n)
 
-// inline f32 brdf_mf(const vec3f32& i, const vec3f32& o, const vec3f32& n) {
-//     auto h = normalize(i + o);
+// generalized half vector of refraction, oriented to n
+inline vec3f32 half_vector_t(const vec3f32& i, const vec3f32& o, const vec3f32& n, f32 eta) {
+    auto h = normalize(o + eta * i);
+    return dot(h, n) < 0.0f ? -h : h;
+}
 
-//     auto numerator = f(i, h) * g(i, o, h) * d(h);
-//     auto denominator = 4.0f * std::abs(dot(i, n)) * std::abs(dot(o, n));
+inline f32 brdf_mf(const vec3f32& i, const vec3f32& o, const vec3f32& n, f32 eta, f32 alpha) {
+    auto cos_i = dot(i, n);
+    auto cos_o = dot(o, n);
+    if(cos_i <= 0.0f || cos_o <= 0.0f) {
+        return 0.0f;
+    }
 
-//     return numerator / denominator;
-// }
+    auto h = normalize(i + o);
 
-// inline f32 btdf_mf(const vec3f32& i, const vec3f32& o, const vec3f32& n) {
-//     auto h = normalize(i + o);
-//     f32 eta_i, eta_o;
+    auto numerator = f(o, h, 1.0f, eta) * g2(i, o, h, n, alpha) * d(h, n, alpha);
+    auto denominator = 4.0f * cos_i * cos_o;
 
-//     auto coef = (std::abs(dot(i, h)) * std::abs(dot(o, h))) / (std::abs(dot(i, n)) * std::abs(dot(o, n)));
-//     auto numerator = eta_o * eta_o * (1.0f - f(i, h)) * g(i, o, h) * d(h);
-//     auto denominator = eta_i * dot(i, h) + eta_o * dot(o, h);
+    return numerator / denominator;
+}
 
-//     return coef * (numerator / (denominator * denominator));
-// }
+// for radiance (scaled by 1 / eta^2)
+inline f32 btdf_mf(const vec3f32& i, const vec3f32& o, const vec3f32& n, f32 eta, f32 alpha) {
+    auto cos_i = dot(i, n);
+    auto cos_o = dot(o, n);
+    if(cos_i >= 0.0f || cos_o <= 0.0f) {
+        return 0.0f;
+    }
 
-// inline f32 bsdf_mf(const vec3f32& i, const vec3f32& o, const vec3f32& m) {
-//     return brdf_mf(i, o, m) + btdf_mf(i, o, m);
-// }
+    auto h = half_vector_t(i, o, n, eta);
+    auto i_h = dot(i, h);
+    auto o_h = dot(o, h);
+    // microfacets facing away from either direction
+    if(i_h >= 0.0f || o_h <= 0.0f) {
+        return 0.0f;
+    }
 
-template<class RandGen>
-inline std::tuple<vec3f32, vec3f32, f32> sample_ggx(const vec3f32& omega_o, const vec3f32& n, f32 roughness, RandGen& rng) {
-    std::uniform_real_distribution<f32> u(0.0f, 1.0f);
+    auto coef = std::abs((i_h * o_h) / (cos_i * cos_o));
+    auto numerator = (1.0f - f(o, h, 1.0f, eta)) * g2(i, o, h, n, alpha) * d(h, n, alpha);
+    auto denominator = eta * i_h + o_h;
+
+    return coef * (numerator / (denominator * denominator));
+}
 
-    auto alpha = roughness * roughness;
+// sample microsurface normal from visible normals, then reflect omega_o on it
+// directions are distributed as D_v, so microfacets facing away from omega_o are never generated
+// pdf(omega_i) = D_v(m) / (4 * |omega_o.m|) = G1(omega_o) * D(m) / (4 * omega_o.n)
+// reference: Jonathan Dupuy, Anis Benyoub - "Sampling Visible GGX Normals with Spherical Caps", 2023
+// f: shading frame (macrosurface normal f.n)
+template<class RandGen>
+inline std::tuple<vec3f32, vec3f32, f32> sample_ggx(const vec3f32& omega_o, const frame& f, f32 roughness, RandGen& rng) {
+    auto alpha = ggx_alpha(roughness);
 
-    auto u1 = u(rng);
-    auto u2 = u(rng);
+    auto u = uniform_2d(rng);
 
-    auto theta = std::atan(alpha * std::sqrt(u1) / std::sqrt(1.0f - u1));
-    auto phi = 2.0f * F32_PI * u2;
+    // omega_o in tangent space, stretched to the hemisphere configuration
+    auto o = f.to_local(omega_o);
+    auto o_std = normalize(vec3f32(alpha * o.x, alpha * o.y, o.z));
 
-    auto x = std::sin(theta) * std::cos(phi);
-    auto y = std::sin(theta) * std::sin(phi);
-    auto z = std::cos(theta);
+    // sample spherical cap in (-o_std.z, 1]
+    auto phi = 2.0f * F32_PI * u.x;
+    auto z = (1.0f - u.y) * (1.0f + o_std.z) - o_std.z;
+    auto sin_theta = std::sqrt(std::clamp(1.0f - z * z, 0.0f, 1.0f));
+    auto c = vec3f32(sin_theta * std::cos(phi), sin_theta * std::sin(phi), z);
 
-    auto m = onb(n, {x, y, z});
+    // unstretch
+    auto m_std = c + o_std;
+    auto m = normalize(f.to_world({alpha * m_std.x, alpha * m_std.y, m_std.z}));
     auto omega_i = reflect(-omega_o, m);
 
-    auto pdf_val = (d(m, n, alpha) * std::abs(dot(m, n))) / (4.0f * std::abs(dot(omega_o, m)));
+    auto cos_o = o.z;
+    auto pdf_val = cos_o > 0.0f ? g1(omega_o, m, f.n, alpha) * d(m, f.n, alpha) / (4.0f * cos_o) : 0.0f;
 
     return { m, omega_i, pdf_val };
 }
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "mapped_file.hpp"
+#include "obj.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+// minimum size of chunk parsed by one task
+constexpr usize OBJ_MIN_CHUNK_SIZE_ = 1 << 20;
+
+// counts of pass 1, and offsets into the merged arrays after prefix sum
+struct obj_chunk_ {
+    const char* begin{};
+    const char* end{};
+
+    u32 vertex_count{};
+    u32 texcoord_count{};
+    u32 normal_count{};
+    u32 triangle_count{};
+
+    // group names and the number of triangles in this chunk before them
+    std::vector<std::pair<std::string_view, u32>> groups{};
+};
+
+inline bool is_space_(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// current line without line feed, p moves to the head of next line
+inline std::string_view next_line_(const char*& p, const char* end) {
+    auto lf = static_cast<const char*>(std::memchr(p, '\n', static_cast<usize>(end - p)));
+    auto line_end = lf ? lf : end;
+
+    std::string_view line(p, static_cast<usize>(line_end - p));
+    p = lf ? lf + 1 : end;
+
+    if(!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+
+    return line;
+}
+
+// current token, line moves to the head of next token
+inline std::string_view next_token_(std::string_view& line) {
+    usize b = 0;
+    while(b < line.size() && is_space_(line[b])) {
+        ++b;
+    }
+    usize e = b;
+    while(e < line.size() && !is_space_(line[e])) {
+        ++e;
+    }
+
+    auto token = line.substr(b, e - b);
+    line.remove_prefix(e);
+
+    return token;
+}
+
+inline f32 parse_f32_(std::string_view token) {
+    f32 v{};
+    std::from_chars(token.data(), token.data() + token.size(), v);
+    return v;
+}
+
+// pass 1: count elements, polygons and group lines
+inline void count_chunk_(obj_chunk_& chunk) {
+    auto p = chunk.begin;
+    while(p < chunk.end) {
+        auto line = next_line_(p, chunk.end);
+        auto head = next_token_(line);
+
+        if(head == "v") {
+            ++chunk.vertex_count;
+        }
+        else if(head == "vt") {
+            ++chunk.texcoord_count;
+        }
+        else if(head == "vn") {
+            ++chunk.normal_count;
+        }
+        else if(head == "f") {
+            u32 corners{};
+            while(!next_token_(line).empty()) {
+                ++corners;
+            }
+            chunk.triangle_count += corners > 2 ? corners - 2 : 0;
+        }
+        else if(head == "g") {
+            chunk.groups.push_back({ next_token_(line), chunk.triangle_count });
+        }
+    }
+}
+
+// pass 2: parse chunk into merged arrays at the offsets of chunk
+// negative (relative) indices are resolved with the global counts at each line
+inline void parse_chunk_(const obj_chunk_& chunk, obj_contents& contents) {
+    auto& [vertices, texcoords, normals, vertex_indices, texcoord_indices, normal_indices, mesh_groups] = contents;
+
+    auto vertex_count = chunk.vertex_count;
+    auto texcoord_count = chunk.texcoord_count;
+    auto normal_count = chunk.normal_count;
+    auto triangle_count = chunk.triangle_count;
+
+    auto p = chunk.begin;
+    while(p < chunk.end) {
+        auto line = next_line_(p, chunk.end);
+        auto head = next_token_(line);
+
+        // vertex
+        if(head == "v") {
+            auto x = parse_f32_(next_token_(line));
+            auto y = parse_f32_(next_token_(line));
+            auto z = parse_f32_(next_token_(line));
+            vertices[vertex_count++] = {x, y, z};
+        }
+        // texcoord
+        else if(head == "vt") {
+            auto u = parse_f32_(next_token_(line));
+            auto v = parse_f32_(next_token_(line));
+            texcoords[texcoord_count++] = {u, v};
+        }
+        // normal
+        else if(head == "vn") {
+            auto x = parse_f32_(next_token_(line));
+            auto y = parse_f32_(next_token_(line));
+            auto z = parse_f32_(next_token_(line));
+            normals[normal_count++] = {x, y, z};
+        }
+        // face (index)
+        else if(head == "f") {
+            auto i0_str = next_token_(line);
+            auto i1_str = next_token_(line);
+            auto [v0, t0, n0] = read_index(i0_str, vertex_count, texcoord_count, normal_count);
+            auto [v1, t1, n1] = read_index(i1_str, vertex_count, texcoord_count, normal_count);
+
+            // (v0, v1, v2) for the first triangle, then fan of (v_k, v0, v_k-1) (same order as load_obj() for quads)
+            bool first = true;
+            for(auto i_str = next_token_(line); !i_str.empty(); i_str = next_token_(line)) {
+                auto [v2, t2, n2] = read_index(i_str, vertex_count, texcoord_count, normal_count);
+
+                if(first) {
+                    vertex_indices[triangle_count] = {v0, v1, v2};
+                    texcoord_indices[triangle_count] = (t0 && t1 && t2) ? vec3u32(*t0, *t1, *t2) : vec3u32(INVALID_INDEX);
+                    normal_indices[triangle_count] = (n0 && n1 && n2) ? vec3u32(*n0, *n1, *n2) : vec3u32(INVALID_INDEX);
+                    first = false;
+                }
+                else {
+                    vertex_indices[triangle_count] = {v2, v0, v1};
+                    texcoord_indices[triangle_count] = (t2 && t0 && t1) ? vec3u32(*t2, *t0, *t1) : vec3u32(INVALID_INDEX);
+                    normal_indices[triangle_count] = (n2 && n0 && n1) ? vec3u32(*n2, *n0, *n1) : vec3u32(INVALID_INDEX);
+                }
+                ++triangle_count;
+
+                v1 = v2;
+                t1 = t2;
+                n1 = n2;
+            }
+        }
+    }
+}
+
+}
+
+obj_contents load_obj_parallel(const char* path) {
+    mapped_file file(path);
+    if(!file) {
+        std::clog << std::format("could not read file: {}", path) << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    auto thread_count = std::max<u32>(1, std::thread::hardware_concurrency());
+
+    // split into line-aligned chunks
+    std::vector<internal_::obj_chunk_> chunks{};
+    {
+        auto chunk_count = std::clamp<usize>(file.size() / internal_::OBJ_MIN_CHUNK_SIZE_, 1, thread_count * 8);
+        auto chunk_size = file.size() / chunk_count + 1;
+
+        auto begin = file.data();
+        auto end = file.data() + file.size();
+        while(begin < end) {
+            auto split = begin + std::min<usize>(chunk_size, static_cast<usize>(end - begin));
+            if(split < end) {
+                auto lf = static_cast<const char*>(std::memchr(split, '\n', static_cast<usize>(end - split)));
+                split = lf ? lf + 1 : end;
+            }
+            chunks.push_back({ .begin = begin, .end = split });
+            begin = split;
+        }
+    }
+
+    // runs f(chunk) for every chunk on all threads
+    auto parallel_chunks = [&](auto&& f) {
+        std::atomic<usize> next{};
+        std::vector<std::thread> threads{};
+        for(u32 i = 0; i < std::min<usize>(thread_count, chunks.size()); ++i) {
+            threads.emplace_back([&] {
+                for(auto c = next++; c < chunks.size(); c = next++) {
+                    f(chunks[c]);
+                }
+            });
+        }
+        for(auto& t : threads) {
+            t.join();
+        }
+    };
+
+    parallel_chunks(internal_::count_chunk_);
+
+    // counts of chunk -> offsets of chunk (exclusive prefix sum)
+    u32 vertex_count{};
+    u32 texcoord_count{};
+    u32 normal_count{};
+    u32 triangle_count{};
+
+    // same rules as load_obj()
+    group_runs mesh_groups{};
+    std::string_view current_group{};
+    u32 current_start{};
+
+    for(auto& chunk : chunks) {
+        for(const auto& [name, local_count] : chunk.groups) {
+            auto group_start = triangle_count + local_count;
+            close_group_run(mesh_groups, current_group, current_start, group_start);
+
+            current_group = name;
+            current_start = group_start;
+        }
+
+        std::swap(vertex_count, chunk.vertex_count);
+        std::swap(texcoord_count, chunk.texcoord_count);
+        std::swap(normal_count, chunk.normal_count);
+        std::swap(triangle_count, chunk.triangle_count);
+        vertex_count += chunk.vertex_count;
+        texcoord_count += chunk.texcoord_count;
+        normal_count += chunk.normal_count;
+        triangle_count += chunk.triangle_count;
+    }
+
+    close_group_run(mesh_groups, current_group, current_start, triangle_count);
+
+    obj_contents contents{
+        std::vector<vec3f32>(vertex_count),
+        std::vector<vec2f32>(texcoord_count),
+        std::vector<vec3f32>(normal_count),
+        std::vector<vec3u32>(triangle_count),
+        std::vector<vec3u32>(triangle_count),
+        std::vector<vec3u32>(triangle_count),
+        std::move(mesh_groups)
+    };
+
+    parallel_chunks([&](const internal_::obj_chunk_& chunk) { internal_::parse_chunk_(chunk, contents); });
+
+    return contents;
+}
+
+}
\ No newline at end of file
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <array>
+#include <charconv>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
@@ -90,17 +93,37 @@ inline std::tuple<u32, std::optional<u32>, std::optional<u32>> read_index(std::s
     }
 }
 
-// (vertices, indices, group mapping (group name, start index, end index + 1))
-inline 
-std::tuple<
+// attribute index of polygon without texcoords / normals
+constexpr u32 INVALID_INDEX = U32_MAX;
+
+// (group name, polygon count) in file order
+// polygons before the first group line belong to unnamed group ""
+using group_runs = std::vector<std::pair<std::string, u32>>;
+
+// (vertices, texcoords, normals, vertex indices, texcoord indices, normal indices, groups)
+// texcoord / normal indices of polygon without the attribute are INVALID_INDEX
+using obj_contents = std::tuple<
     std::vector<vec3f32>,
     std::vector<vec2f32>,
     std::vector<vec3f32>,
     std::vector<vec3u32>,
-    std::vector<std::optional<vec3u32>>,
-    std::vector<std::optional<vec3u32>>,
-    std::unordered_map<std::string, u32>
-> load_obj(const char* path) {
+    std::vector<vec3u32>,
+    std::vector<vec3u32>,
+    group_runs
+>;
+
+// closes polygons [start, end) of current group, empty runs are dropped
+inline void close_group_run(group_runs& groups, std::string_view name, u32 start, u32 end) {
+    if(end > start) {
+        groups.push_back({std::string(name), end - start});
+    }
+}
+
+// memory-mapped loader for large files, parses line-aligned chunks in parallel (see obj.cpp)
+// same result as load_obj(), polygons with more than 4 vertices are triangulated as fans
+obj_contents load_obj_parallel(const char* path);
+
+inline obj_contents load_obj(const char* path) {
     std::FILE* fp = std::fopen(path, "r");
     if(!fp) {
         std::clog << std::format("could not read file: {}", path) << std::endl;
@@ -111,11 +134,10 @@ std::tuple<
     std::vector<vec2f32> texcoords{};
     std::vector<vec3f32> normals{};
     std::vector<vec3u32> vertex_indices{};
-    std::vector<std::optional<vec3u32>> texcoord_indices{};
-    std::vector<std::optional<vec3u32>> normal_indices{};
+    std::vector<vec3u32> texcoord_indices{};
+    std::vector<vec3u32> normal_indices{};
 
-    // group name -> polygon count
-    std::unordered_map<std::string, u32> mesh_groups{};
+    group_runs mesh_groups{};
 
     // maximum line length of .obj file
     constexpr u32 BUF_SIZE = 256;
@@ -123,7 +145,7 @@ std::tuple<
     u32 line{};
 
     std::string current_group{};
-    u32 current_count{};
+    u32 current_start{};
 
     while(!std::feof(fp)) {
         buf.fill('\0');
@@ -142,6 +164,10 @@ std::tuple<
         if(str.find('\n') != std::string_view::npos) {
             str.remove_suffix(1);
         }
+        // CRLF
+        if(!str.empty() && str.back() == '\r') {
+            str.remove_suffix(1);
+        }
 
         // remove spaces at the end
         auto last = str.find_last_not_of(' ');
@@ -234,13 +260,13 @@ std::tuple<
                 texcoord_indices.push_back(vec3u32(*t0, *t1, *t2));
             }
             else {
-                texcoord_indices.push_back(std::nullopt);
+                texcoord_indices.push_back(vec3u32(INVALID_INDEX));
             }
             if(n0 && n1 && n2) {
                 normal_indices.push_back(vec3u32(*n0, *n1, *n2));
             }
             else {
-                normal_indices.push_back(std::nullopt);
+                normal_indices.push_back(vec3u32(INVALID_INDEX));
             }
 
             // face has 4 indices
@@ -253,13 +279,13 @@ std::tuple<
                     texcoord_indices.push_back(vec3u32(*t3, *t0, *t2));
                 }
                 else {
-                    texcoord_indices.push_back(std::nullopt);
+                    texcoord_indices.push_back(vec3u32(INVALID_INDEX));
                 }
                 if(n3 && n0 && n2) {
                     normal_indices.push_back(vec3u32(*n3, *n0, *n2));
                 }
                 else {
-                    normal_indices.push_back(std::nullopt);
+                    normal_indices.push_back(vec3u32(INVALID_INDEX));
                 }
             }
         }
@@ -270,16 +296,10 @@ std::tuple<
             auto group_name = read_token(str);
             seek_token(str);
 
-            if(current_group.empty()) {
-                current_group = group_name;
-                current_count = 0;
-            }
-            else {
-                mesh_groups[current_group] = static_cast<u32>(vertex_indices.size()) - current_count;
+            close_group_run(mesh_groups, current_group, current_start, static_cast<u32>(vertex_indices.size()));
 
-                current_group = group_name;
-                current_count = static_cast<u32>(vertex_indices.size());
-            }
+            current_group = group_name;
+            current_start = static_cast<u32>(vertex_indices.size());
         }
         // other token -> skip
         else {
@@ -287,17 +307,11 @@ std::tuple<
         }
     }
 
-    // .obj file has no groups -> register group with all polygons
-    if(mesh_groups.empty()) {
-        mesh_groups[""] = static_cast<u32>(vertex_indices.size());
-    }
-    else {
-        mesh_groups[current_group] = static_cast<u32>(vertex_indices.size()) - current_count;
-    }
+    close_group_run(mesh_groups, current_group, current_start, static_cast<u32>(vertex_indices.size()));
 
     std::fclose(fp);
 
-    return { vertices, texcoords, normals, vertex_indices, texcoord_indices, normal_indices, mesh_groups };
+    return { std::move(vertices), std::move(texcoords), std::move(normals), std::move(vertex_indices), std::move(texcoord_indices), std::move(normal_indices), std::move(mesh_groups) };
 }
 
 }
\ No newline at end of file
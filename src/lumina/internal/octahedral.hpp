@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+
+#include "vector.hpp"
+
+namespace lumina {
+
+// unit vector in 2 x 16-bit, octahedral encoding
+// reference: Cigolle et al. - "A Survey of Efficient Representations for Independent Unit Vectors", 2014
+inline std::array<s16, 2> encode_octahedral(const vec3f32& n) noexcept {
+    constexpr f32 scale = 32767.0f;
+    auto l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    auto x = n.x / l1;
+    auto y = n.y / l1;
+    if(n.z < 0.0f) {
+        auto fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        auto fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    return {
+        static_cast<s16>(std::round(std::clamp(x, -1.0f, 1.0f) * scale)),
+        static_cast<s16>(std::round(std::clamp(y, -1.0f, 1.0f) * scale))
+    };
+}
+
+inline vec3f32 decode_octahedral(const std::array<s16, 2>& e) noexcept {
+    constexpr f32 scale = 32767.0f;
+    auto x = f32(e[0]) / scale;
+    auto y = f32(e[1]) / scale;
+    auto z = 1.0f - std::abs(x) - std::abs(y);
+    auto t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    return normalize(vec3f32(x, y, z));
+}
+
+}
\ No newline at end of file
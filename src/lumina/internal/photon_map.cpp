@@ -0,0 +1,88 @@
+#include <iostream>
+
+#include "photon_map.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+photon_sources_ photon_sources_of_(const mesh& mesh) {
+    photon_sources_ sources{};
+
+    aabb bounds{};
+    for(const auto& v : mesh.vertices) {
+        bounds += aabb(v, v);
+    }
+    sources.center = bounds.centroid();
+    sources.radius = bounds ? norm(bounds.max - bounds.min) * 0.5f : 0.0f;
+
+    // two-sided Lambertian emitter: flux = 2 * pi * area * emitted radiance
+    for(u32 i = 0; i < mesh.vertex_indices.size(); ++i) {
+        const auto& e = mesh.material(i).emission;
+        if(std::max({e.x, e.y, e.z}) <= 0.0f) {
+            continue;
+        }
+        const auto& index = mesh.vertex_indices[i];
+        auto area = 0.5f * norm(cross(mesh.vertices[index.y] - mesh.vertices[index.x], mesh.vertices[index.z] - mesh.vertices[index.x]));
+        sources.polygons.push_back(i);
+        sources.power.push_back(e * (2.0f * F32_PI * area));
+    }
+
+    // constant background radiance through the disc of the bounding sphere from every direction: 4 * pi * pi * r^2 * radiance
+    sources.power.push_back(BACKGROUND_RADIANCE * (4.0f * F32_PI * F32_PI * sources.radius * sources.radius));
+
+    f64 total{};
+    for(const auto& p : sources.power) {
+        total += (p.r + p.g + p.b) / 3.0;
+    }
+    f64 sum{};
+    for(const auto& p : sources.power) {
+        sum += (p.r + p.g + p.b) / 3.0;
+        sources.cdf.push_back(static_cast<f32>(sum / total));
+    }
+    sources.cdf.back() = 1.0f;
+
+    return sources;
+}
+
+}
+
+photon_map::photon_map(std::vector<photon> photons, u32 emitted, const photon_options& options) :
+    tree_([&] {
+        // positions and records separately, the tree keeps both in its own node order
+        std::vector<vec3f32> positions(photons.size());
+        std::vector<photon_record> records(photons.size());
+        for(usize i = 0; i < photons.size(); ++i) {
+            positions[i] = photons[i].position;
+            records[i] = photons[i].record;
+        }
+        photons = {};
+        return kdtree<photon_record>(positions, std::move(records));
+    }()),
+    emitted_(emitted),
+    options_(options)
+{}
+
+vec3f32 photon_map::estimate(const vec3f32& x, const vec3f32& omega_o, const bsdf& surface) const {
+    std::array<kdtree_neighbor<photon_record>, MAX_GATHER_COUNT> buffer{};
+    auto k = std::min(options_.gather_count, MAX_GATHER_COUNT);
+    auto neighbors = tree_.knn_search(x, std::span(buffer).first(k), options_.max_radius);
+    if(neighbors.empty()) {
+        return {};
+    }
+
+    vec3f32 flux{};
+    for(const auto& n : neighbors) {
+        flux += surface.eval(omega_o, decode_octahedral(n.payload->direction)) * decode_rgbe(n.payload->power);
+    }
+
+    auto radius2 = neighbors.size() == k ? neighbors.back().distance2 : options_.max_radius * options_.max_radius;
+    return flux / (F32_PI * std::max(radius2, 1.0e-12f));
+}
+
+void photon_map::statistics() const {
+    std::cout << std::format("# of emitted photons: {}, # of stored photons: {} ({:.2f} per emitted photon), photon memory: {:.1f} MB\n", emitted_, tree_.size(), f64(tree_.size()) / f64(std::max<u32>(1, emitted_)), f64(tree_.resident_bytes()) / (1 << 20));
+    std::cout << std::flush;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "integrator.hpp"
+#include "kdtree.hpp"
+#include "octahedral.hpp"
+#include "rng.hpp"
+
+namespace lumina {
+
+// photon tracing and density estimation controls
+struct photon_options {
+    // emitted photons (emissive polygons and background together)
+    u32 photons = 1 << 20;
+    // russian roulette is applied after this number of bounces
+    u32 min_depth = 3;
+    // hard limit of traced rays per photon path
+    u32 max_depth = 16;
+    // photons are stored on surfaces at least this rough (diffuse surfaces always), camera paths stop there to gather
+    // smoother surfaces are followed by bsdf sampling, light focused by them becomes caustics in the map
+    // density estimates of sharp glossy lobes are dominated by a few photons (blotches), so keep this high
+    f32 min_roughness = 0.5f;
+    // density estimation from the gather_count nearest photons within max_radius (up to MAX_GATHER_COUNT)
+    u32 gather_count = 64;
+    f32 max_radius = 0.1f;
+};
+
+// rgb in 32-bit with a shared exponent
+// reference: Greg Ward - "Real Pixels", Graphics Gems II, 1991
+inline u32 encode_rgbe(const vec3f32& c) noexcept {
+    auto m = std::max({c.r, c.g, c.b});
+    if(m < 1.0e-32f) {
+        return 0;
+    }
+    int e{};
+    auto scale = std::frexp(m, &e) * 256.0f / m;
+    return u32(c.r * scale) | u32(c.g * scale) << 8 | u32(c.b * scale) << 16 | u32(e + 128) << 24;
+}
+
+inline vec3f32 decode_rgbe(u32 rgbe) noexcept {
+    auto e = rgbe >> 24;
+    if(e == 0) {
+        return {};
+    }
+    auto f = std::ldexp(1.0f, static_cast<int>(e) - (128 + 8));
+    return vec3f32(f32(rgbe & 0xff) + 0.5f, f32(rgbe >> 8 & 0xff) + 0.5f, f32(rgbe >> 16 & 0xff) + 0.5f) * f;
+}
+
+// what a photon carries, payload of the photon kdtree (position is kept by the tree)
+struct photon_record {
+    // flux carried by the photon (rgbe), already divided by the number of emitted photons
+    u32 power;
+    // direction towards where the photon came from (omega_i at the surface), octahedral
+    std::array<s16, 2> direction;
+};
+
+// photon stored on a surface, 20 bytes
+// reference: Henrik Wann Jensen - "Realistic Image Synthesis Using Photon Mapping", 2001
+struct photon {
+    vec3f32 position;
+    photon_record record;
+};
+
+static_assert(sizeof(photon) == 20);
+
+namespace internal_ {
+
+// photons are stored and gathered on this material
+inline bool is_gathered_(const material& mat, const photon_options& options) noexcept {
+    return mat.type == material_type::diffuse || mat.roughness >= options.min_roughness;
+}
+
+}
+
+// photons of one tracing pass indexed by kdtree for k-nearest density estimation
+class photon_map {
+public:
+    static constexpr u32 MAX_GATHER_COUNT = 256;
+
+private:
+    kdtree<photon_record> tree_;
+    u32 emitted_;
+    photon_options options_;
+
+public:
+    photon_map(std::vector<photon> photons, u32 emitted, const photon_options& options);
+
+    // reflected radiance towards omega_o at x (sum of bsdf * power over the nearest photons / disc area)
+    // radius of the disc is the farthest of gather_count photons, max_radius if fewer photons are nearby
+    vec3f32 estimate(const vec3f32& x, const vec3f32& omega_o, const bsdf& surface) const;
+
+    // photons are stored and gathered on this material
+    bool is_gathered(const material& mat) const noexcept {
+        return internal_::is_gathered_(mat, options_);
+    }
+
+    // number of stored photons
+    usize size() const noexcept { return tree_.size(); }
+    u32 emitted() const noexcept { return emitted_; }
+    const photon_options& options() const noexcept { return options_; }
+
+    void statistics() const;
+};
+
+namespace internal_ {
+
+// emitted photons per parallel work item, every chunk has its own random sequence
+constexpr u32 PHOTON_CHUNK_SIZE_ = 4096;
+
+// where photons are emitted from: emissive polygons (two-sided Lambertian emitters) and the constant background
+// chosen proportional to emitted power
+struct photon_sources_ {
+    // emissive polygon indices, background is the entry after the last polygon
+    std::vector<u32> polygons;
+    // cumulative probabilities of polygons and the background
+    std::vector<f32> cdf;
+    // flux of every entry
+    std::vector<vec3f32> power;
+    // bounding sphere of the scene, background photons enter through a disc of this radius
+    vec3f32 center;
+    f32 radius;
+};
+
+photon_sources_ photon_sources_of_(const mesh& mesh);
+
+// russian roulette and bsdf sampling of a photon path, calls store(position, omega_i, power) on every gathered surface
+// closest_hit: ray -> std::optional<surface_hit_>
+template<class ClosestHit, class RandGen, class Store>
+void trace_photon_(ray r, vec3f32 power, ClosestHit&& closest_hit, RandGen& rng, const photon_options& options, Store&& store) {
+    constexpr f32 eps = 0.0001f;
+
+    for(u32 depth = 0; depth < options.max_depth; ++depth) {
+        auto hit = closest_hit(r);
+        if(!hit) {
+            break;
+        }
+
+        const auto& material = *hit->mat;
+        auto x = r[hit->t];
+        auto n = hit->normal;
+        auto entering = dot(r.direction, n) < 0.0f;
+        n = entering ? n : -n;
+        auto omega_o = -r.direction;
+
+        if(is_gathered_(material, options)) {
+            store(x, omega_o, power);
+        }
+
+        bsdf surface(material, frame(n), entering, transport_mode::importance);
+        auto sample = surface.sample(omega_o, rng);
+        if(!sample) {
+            break;
+        }
+
+        // survival follows the scattered fraction, so surviving photons keep about the same power
+        auto scattered = power * sample->weight;
+        if(depth + 1 >= options.min_depth) {
+            auto p_rr = std::min(1.0f, std::max({sample->weight.r, sample->weight.g, sample->weight.b}));
+            if(uniform_1d(rng) >= p_rr) {
+                break;
+            }
+            scattered *= 1.0f / p_rr;
+        }
+        power = scattered;
+
+        auto offset = dot(sample->omega_i, n) > 0.0f ? n * eps : -n * eps;
+        r = ray(x + offset, sample->omega_i);
+    }
+}
+
+// trace_path_ policy of camera paths: smooth surfaces are followed by bsdf sampling, the path ends at the first gathered surface
+// light arriving at the gathered surface comes from gather only
+// gather: (position, omega_o, bsdf, path throughput) -> radiance added to the path
+template<class Gather>
+auto stop_at_gathered_(const photon_options& options, Gather gather) {
+    return [&options, gather](const material& mat, const vec3f32& x, const vec3f32& omega_o, const bsdf& surface, const vec3f32& alpha) -> std::optional<vec3f32> {
+        if(!is_gathered_(mat, options)) {
+            return std::nullopt;
+        }
+        return gather(x, omega_o, surface, alpha);
+    };
+}
+
+// traces options.photons photons from emissive polygons and the background on all hardware threads
+// calls store(chunk, position, omega_i, power) for every photon stored on a gathered surface, chunks run on one thread each
+// photons of a chunk do not depend on the number of threads for the same seed
+template<triangle_accelerator Accelerator, class Store>
+void for_each_photon_(const Accelerator& bvh, const mesh& mesh, const photon_options& options, u64 seed, Store&& store) {
+    constexpr f32 eps = 0.0001f;
+
+    auto sources = photon_sources_of_(mesh);
+    // shared by all threads, so no per-thread statistics counters
+    auto closest_hit = closest_hit_of_(bvh, mesh);
+
+    auto chunk_count = (options.photons + PHOTON_CHUNK_SIZE_ - 1) / PHOTON_CHUNK_SIZE_;
+    std::atomic<u32> next{};
+
+    auto thread_count = std::max<u32>(1, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads{};
+    for(u32 t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&] {
+            for(auto c = next++; c < chunk_count; c = next++) {
+                xoshiro256pp rng(seed + c);
+                auto store_chunk = [&](const vec3f32& x, const vec3f32& omega_i, const vec3f32& power) { store(c, x, omega_i, power); };
+                auto end = std::min(options.photons, (c + 1) * PHOTON_CHUNK_SIZE_);
+
+                for(auto i = c * PHOTON_CHUNK_SIZE_; i < end; ++i) {
+                    auto source = std::min<usize>(std::upper_bound(sources.cdf.begin(), sources.cdf.end(), uniform_1d(rng)) - sources.cdf.begin(), sources.cdf.size() - 1);
+                    auto p = source == 0 ? sources.cdf[0] : sources.cdf[source] - sources.cdf[source - 1];
+                    auto power = sources.power[source] / (p * f32(options.photons));
+
+                    if(source == sources.polygons.size()) {
+                        // background: parallel rays through a disc in front of the bounding sphere
+                        auto direction = sample_uniform_sphere(frame(vec3f32(0.0f, 0.0f, 1.0f)), rng);
+                        frame disc(direction);
+                        auto u = uniform_2d(rng);
+                        auto radius = sources.radius * std::sqrt(u.x);
+                        auto phi = 2.0f * F32_PI * u.y;
+                        auto origin = sources.center - direction * sources.radius + disc.to_world(vec3f32(radius * std::cos(phi), radius * std::sin(phi), 0.0f));
+                        trace_photon_(ray(origin, direction), power, closest_hit, rng, options, store_chunk);
+                        continue;
+                    }
+
+                    const auto& index = mesh.vertex_indices[sources.polygons[source]];
+                    const auto& p0 = mesh.vertices[index.x];
+                    auto e1 = mesh.vertices[index.y] - p0;
+                    auto e2 = mesh.vertices[index.z] - p0;
+                    auto n = normalize(cross(e1, e2));
+                    n = uniform_1d(rng) < 0.5f ? n : -n;
+                    auto x = sample_uniform_triangle(p0, e1, e2, rng);
+                    auto direction = sample_cosine_hemisphere(frame(n), rng);
+                    trace_photon_(ray(x + n * eps, direction), power, closest_hit, rng, options, store_chunk);
+                }
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+}
+
+}
+
+// photon tracing pass: options.photons photons from emissive polygons and the background, traced on all hardware threads
+// the result does not depend on the number of threads for the same seed
+template<triangle_accelerator Accelerator>
+photon_map trace_photons(const Accelerator& bvh, const mesh& mesh, const photon_options& options, u64 seed) {
+    auto chunk_count = (options.photons + internal_::PHOTON_CHUNK_SIZE_ - 1) / internal_::PHOTON_CHUNK_SIZE_;
+    std::vector<std::vector<photon>> chunks(chunk_count);
+    internal_::for_each_photon_(bvh, mesh, options, seed, [&](u32 chunk, const vec3f32& x, const vec3f32& omega_i, const vec3f32& power) {
+        chunks[chunk].push_back({ x, { encode_rgbe(power), encode_octahedral(omega_i) } });
+    });
+
+    usize count{};
+    for(const auto& c : chunks) {
+        count += c.size();
+    }
+    std::vector<photon> photons{};
+    photons.reserve(count);
+    for(auto& c : chunks) {
+        photons.insert(photons.end(), c.begin(), c.end());
+        c = {};
+    }
+
+    return photon_map(std::move(photons), options.photons, options);
+}
+
+// camera pass of photon mapping: smooth surfaces are path traced, the first rough surface gathers from photon map
+template<triangle_accelerator Accelerator, class RandGen>
+path_result trace_ray(const ray& r, const Accelerator& bvh, const mesh& mesh, const photon_map& photons, RandGen& rng, const path_options& options = {}) {
+    auto gather = [&](const vec3f32& x, const vec3f32& omega_o, const bsdf& surface, const vec3f32& alpha) { return alpha * photons.estimate(x, omega_o, surface); };
+    return internal_::trace_path_(r, internal_::closest_hit_of_(bvh, mesh, internal_::statistics_counters_()), rng, options, internal_::stop_at_gathered_(photons.options(), gather));
+}
+
+}
\ No newline at end of file
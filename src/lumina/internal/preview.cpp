@@ -0,0 +1,174 @@
+#include <array>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string_view>
+
+#include "preview.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+inline std::string_view trim_(std::string_view s) noexcept {
+    auto first = s.find_first_not_of(" \t\r");
+    if(first == std::string_view::npos) {
+        return {};
+    }
+    auto last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+// whitespace separated numbers, std::nullopt unless there are exactly N
+template<usize N>
+std::optional<std::array<f32, N>> parse_floats_(std::string_view s) {
+    std::array<f32, N> values{};
+    usize count{};
+    while(!(s = trim_(s)).empty()) {
+        if(count == N) {
+            return std::nullopt;
+        }
+        auto [end, error] = std::from_chars(s.data(), s.data() + s.size(), values[count]);
+        if(error != std::errc{}) {
+            return std::nullopt;
+        }
+        ++count;
+        s.remove_prefix(static_cast<usize>(end - s.data()));
+    }
+    if(count != N) {
+        return std::nullopt;
+    }
+    return values;
+}
+
+inline std::optional<vec3f32> parse_vec3_(std::string_view s) {
+    auto v = parse_floats_<3>(s);
+    return v ? std::optional(vec3f32((*v)[0], (*v)[1], (*v)[2])) : std::nullopt;
+}
+
+inline std::optional<f32> parse_scalar_(std::string_view s) {
+    auto v = parse_floats_<1>(s);
+    return v ? std::optional((*v)[0]) : std::nullopt;
+}
+
+inline std::optional<material_type> parse_material_type_(std::string_view s) {
+    for(auto t : {material_type::diffuse, material_type::conductor, material_type::dielectric}) {
+        if(s == to_string(t)) {
+            return t;
+        }
+    }
+    return std::nullopt;
+}
+
+// applies one "key = values" line to config, false if the key or the values are invalid
+bool apply_preview_line_(std::string_view key, std::string_view values, preview_config& config) {
+    auto assign = [](auto& target, const auto& value) {
+        if(!value) {
+            return false;
+        }
+        target = *value;
+        return true;
+    };
+
+    if(key == "from") {
+        return assign(config.from, parse_vec3_(values));
+    }
+    if(key == "at") {
+        return assign(config.at, parse_vec3_(values));
+    }
+    if(key == "up") {
+        return assign(config.up, parse_vec3_(values));
+    }
+    if(key == "fov") {
+        return assign(config.fov, parse_scalar_(values));
+    }
+
+    // group names may contain dots, the field is after the last one
+    auto dot = key.rfind('.');
+    if(dot == std::string_view::npos) {
+        return false;
+    }
+    auto found = config.materials.find(std::string(key.substr(0, dot)));
+    if(found == config.materials.end()) {
+        return false;
+    }
+    auto& m = found->second;
+    auto field = key.substr(dot + 1);
+    if(field == "albedo") {
+        return assign(m.albedo, parse_vec3_(values));
+    }
+    if(field == "emission") {
+        return assign(m.emission, parse_vec3_(values));
+    }
+    if(field == "roughness") {
+        return assign(m.roughness, parse_scalar_(values));
+    }
+    if(field == "refractive_index") {
+        return assign(m.refractive_index, parse_scalar_(values));
+    }
+    if(field == "type") {
+        return assign(m.type, parse_material_type_(values));
+    }
+    return false;
+}
+
+}
+
+bool load_preview_config(const std::filesystem::path& path, preview_config& config) {
+    std::ifstream ifs(path);
+    if(ifs.fail()) {
+        std::clog << std::format("failed to open file: {}", path.string()) << std::endl;
+        return false;
+    }
+
+    // all lines are applied to a copy, a half edited file does not change anything
+    auto result = config;
+    std::string line{};
+    for(u32 number = 1; std::getline(ifs, line); ++number) {
+        auto content = internal_::trim_(std::string_view(line).substr(0, line.find('#')));
+        if(content.empty()) {
+            continue;
+        }
+        auto equal = content.find('=');
+        if(equal == std::string_view::npos || !internal_::apply_preview_line_(internal_::trim_(content.substr(0, equal)), internal_::trim_(content.substr(equal + 1)), result)) {
+            std::clog << std::format("{}:{}: invalid line: {}", path.string(), number, content) << std::endl;
+            return false;
+        }
+    }
+
+    config = std::move(result);
+    return true;
+}
+
+bool save_preview_config(const std::filesystem::path& path, const preview_config& config) {
+    std::ostringstream oss{};
+    auto vec3 = [](const vec3f32& v) { return std::format("{} {} {}", v.x, v.y, v.z); };
+
+    oss << "# camera\n";
+    oss << std::format("from = {}\nat = {}\nup = {}\nfov = {}\n", vec3(config.from), vec3(config.at), vec3(config.up), config.fov);
+
+    // sorted by group name, the map itself has no stable order
+    std::map<std::string, material> materials(config.materials.begin(), config.materials.end());
+    for(const auto& [name, m] : materials) {
+        oss << std::format("\n# {}\n", name);
+        oss << std::format("{}.albedo = {}\n", name, vec3(m.albedo));
+        oss << std::format("{}.emission = {}\n", name, vec3(m.emission));
+        oss << std::format("{}.roughness = {}\n", name, m.roughness);
+        oss << std::format("{}.refractive_index = {}\n", name, m.refractive_index);
+        oss << std::format("{}.type = {}\n", name, to_string(m.type));
+    }
+
+    std::ofstream ofs(path);
+    ofs << oss.str();
+    if(ofs.fail()) {
+        std::clog << std::format("failed to write file: {}", path.string()) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+#include "material.hpp"
+#include "vector.hpp"
+
+namespace lumina {
+
+// camera and materials edited while the interactive preview runs
+struct preview_config {
+    vec3f32 from;
+    vec3f32 at;
+    vec3f32 up;
+    // vertical field of view in degrees
+    f32 fov;
+    // group name -> material
+    std::unordered_map<std::string, material> materials;
+};
+
+// overrides parameters of config by the lines of a text file
+// one "key = values" per line, '#' starts a comment
+//   from = x y z / at = x y z / up = x y z / fov = degrees
+//   <group>.albedo = r g b / <group>.emission = r g b / <group>.roughness = v / <group>.refractive_index = v
+//   <group>.type = diffuse | conductor | dielectric
+// groups have to exist in config.materials
+// false (with a message on std::clog, config unchanged) if the file cannot be read or a line is invalid
+bool load_preview_config(const std::filesystem::path& path, preview_config& config);
+
+// every parameter of config in the format above, starting point for editing
+bool save_preview_config(const std::filesystem::path& path, const preview_config& config);
+
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include <cassert>
+#include <cmath>
+#include <tuple>
+
+#include "qbvh.hpp"
+
+namespace lumina {
+
+namespace internal_ {
+
+// (index, box) of a binary bvh child slot
+struct qbvh_slot_ {
+    s32 index;
+    aabb box;
+};
+
+// child bounds of node, rounded outwards so dequantized bounds always contain the exact bounds
+inline void set_children_(qbvh_node& node, const std::vector<qbvh_slot_>& slots) {
+    aabb box{};
+    for(const auto& slot : slots) {
+        box += slot.box;
+    }
+
+    node.origin = box.min;
+    for(u32 axis = 0; axis < 3; ++axis) {
+        auto extent = box.max[axis] - box.min[axis];
+        auto scale = extent / 255.0f;
+        // q == 255 has to reach the top of node box
+        while(node.origin[axis] + 255.0f * scale < box.max[axis]) {
+            scale = std::nextafter(scale, F32_MAX);
+        }
+        node.scale[axis] = scale;
+    }
+
+    for(u32 i = 0; i < 4; ++i) {
+        if(i >= slots.size()) {
+            for(u32 axis = 0; axis < 3; ++axis) {
+                node.lo[axis][i] = 255;
+                node.hi[axis][i] = 0;
+            }
+            node.children[i] = qbvh_node::EMPTY_CHILD;
+            continue;
+        }
+
+        for(u32 axis = 0; axis < 3; ++axis) {
+            auto origin = node.origin[axis];
+            auto scale = node.scale[axis];
+            auto min = slots[i].box.min[axis];
+            auto max = slots[i].box.max[axis];
+
+            // same expression as qbvh_node::child_box()
+            auto dequantize = [&](s32 q) { return origin + f32(q) * scale; };
+
+            s32 lo = 0;
+            s32 hi = 0;
+            if(scale > 0.0f) {
+                lo = std::clamp(s32(std::floor((min - origin) / scale)), 0, 255);
+                hi = std::clamp(s32(std::ceil((max - origin) / scale)), 0, 255);
+            }
+            while(lo > 0 && dequantize(lo) > min) {
+                --lo;
+            }
+            while(hi < 255 && dequantize(hi) < max) {
+                ++hi;
+            }
+
+            node.lo[axis][i] = static_cast<u8>(lo);
+            node.hi[axis][i] = static_cast<u8>(hi);
+        }
+    }
+}
+
+inline void set_children_(wide_bvh_node& node, const std::vector<qbvh_slot_>& slots) {
+    for(u32 i = 0; i < 4; ++i) {
+        node.boxes[i] = i < slots.size() ? slots[i].box : aabb{};
+        node.children[i] = wide_bvh_node::EMPTY_CHILD;
+    }
+}
+
+}
+
+template<class Node>
+wide_bvh<Node>::wide_bvh(const bvh& bvh) :
+    wide_bvh(bvh.nodes())
+{}
+
+template<class Node>
+wide_bvh<Node>::wide_bvh(std::span<const bvh_node> binary) {
+    nodes_.push_back({});
+
+    // (binary node, qbvh node, depth of qbvh node)
+    std::queue<std::tuple<s32, u32, u32>> build_queue{};
+    build_queue.push({0, 0, 0});
+
+    while(!build_queue.empty()) {
+        auto [binary_idx, node_idx, depth] = build_queue.front();
+        build_queue.pop();
+
+        // traversal stack of trace() is sized for this depth
+        if(depth >= BVH_MAX_DEPTH) {
+            std::clog << std::format("bvh deeper than BVH_MAX_DEPTH ({}) cannot be collapsed. exit.", BVH_MAX_DEPTH) << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        std::vector<internal_::qbvh_slot_> slots = {
+            { binary[binary_idx].left_index, binary[binary_idx].left_box },
+            { binary[binary_idx].right_index, binary[binary_idx].right_box }
+        };
+
+        // open the internal child with the largest surface area until 4 children
+        while(slots.size() < 4) {
+            auto largest = slots.end();
+            for(auto it = slots.begin(); it != slots.end(); ++it) {
+                if(it->index > 0 && (largest == slots.end() || it->box.area() > largest->box.area())) {
+                    largest = it;
+                }
+            }
+            if(largest == slots.end()) {
+                break;
+            }
+
+            const auto& opened = binary[largest->index];
+            *largest = { opened.left_index, opened.left_box };
+            slots.push_back({ opened.right_index, opened.right_box });
+        }
+
+        internal_::set_children_(nodes_[node_idx], slots);
+
+        for(u32 i = 0; i < slots.size(); ++i) {
+            // leaf -> primitive index as is
+            if(slots[i].index <= 0) {
+                nodes_[node_idx].children[i] = slots[i].index;
+            }
+            else {
+                auto child_idx = static_cast<u32>(nodes_.size());
+                nodes_[node_idx].children[i] = static_cast<s32>(child_idx);
+                nodes_.push_back({});
+                build_queue.push({slots[i].index, child_idx, depth + 1});
+            }
+        }
+    }
+}
+
+template<class Node>
+void wide_bvh<Node>::reorder() {
+    // pass 1: depth first visiting order of trace() (last slot first)
+    std::vector<s32> new_index(nodes_.size());
+    s32 count{};
+
+    std::vector<s32> stack{0};
+    while(!stack.empty()) {
+        auto index = stack.back();
+        stack.pop_back();
+        new_index[index] = count++;
+
+        for(auto child : nodes_[index].children) {
+            if(child != Node::EMPTY_CHILD && child > 0) {
+                stack.push_back(child);
+            }
+        }
+    }
+
+    // pass 2: move nodes, slots stay in place
+    std::vector<Node> nodes(nodes_.size());
+    for(size_t i = 0; i < nodes_.size(); ++i) {
+        auto node = nodes_[i];
+        for(auto& child : node.children) {
+            if(child != Node::EMPTY_CHILD && child > 0) {
+                child = new_index[child];
+            }
+        }
+        nodes[new_index[i]] = node;
+    }
+    nodes_ = std::move(nodes);
+}
+
+template<class Node>
+std::optional<std::pair<u32, f32>> wide_bvh<Node>::trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max) const {
+    return trace_<false>(vertices, indices, r, t_max, nullptr);
+}
+
+template<class Node>
+std::optional<std::pair<u32, f32>> wide_bvh<Node>::trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters& counters) const {
+    return trace_<true>(vertices, indices, r, t_max, &counters);
+}
+
+template<class Node>
+template<bool Count>
+std::optional<std::pair<u32, f32>> wide_bvh<Node>::trace_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters* counters) const {
+    auto inv_direction = vec3f32(1.0f / r.direction.x, 1.0f / r.direction.y, 1.0f / r.direction.z);
+
+    // depth first, boxes beyond the closest hit are culled
+    std::array<s32, internal_::WIDE_BVH_STACK_SIZE_> stack{};
+    u32 top{};
+    stack[top++] = 0;
+
+    f32 t = t_max;
+    u32 i = U32_MAX;
+
+    while(top > 0) {
+        const auto& node = nodes_[stack[--top]];
+        if constexpr(Count) {
+            ++counters->nodes;
+        }
+
+        for(u32 c = 0; c < 4; ++c) {
+            auto child = node.children[c];
+            if(child == Node::EMPTY_CHILD) {
+                continue;
+            }
+            if constexpr(Count) {
+                ++counters->boxes;
+            }
+            if(!internal_::hit_box_(r, inv_direction, node.child_box(c), t)) {
+                continue;
+            }
+
+            // internal
+            if(child > 0) {
+                assert(top < stack.size());
+                stack[top++] = child;
+            }
+            // leaf
+            else {
+                auto tri_idx = static_cast<u32>(-child);
+                if constexpr(Count) {
+                    ++counters->triangles;
+                }
+                auto curr_t = intersect(r, {vertices[indices[tri_idx].x], vertices[indices[tri_idx].y], vertices[indices[tri_idx].z]});
+                if(curr_t && *curr_t < t) {
+                    t = *curr_t;
+                    i = tri_idx;
+                }
+            }
+        }
+    }
+
+    if(i == U32_MAX) {
+        return std::nullopt;
+    }
+    else {
+        return {{i, t}};
+    }
+}
+
+template class wide_bvh<qbvh_node>;
+template class wide_bvh<wide_bvh_node>;
+
+}
\ No newline at end of file
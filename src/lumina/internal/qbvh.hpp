@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "bvh.hpp"
+
+namespace lumina {
+
+// 4-wide bvh node with child bounds quantized to 8 bits against the node box, one cache line
+// reference: Ylitie et al. - "Efficient Incoherent Ray Traversal on GPUs Through Compressed Wide BVHs", 2017
+struct alignas(64) qbvh_node {
+    // child bound = origin + q * scale
+    vec3f32 origin;
+    vec3f32 scale;
+    // per axis, per child
+    std::array<std::array<u8, 4>, 3> lo;
+    std::array<std::array<u8, 4>, 3> hi;
+    // positive -> index of child node
+    // 0 or negative -> index of primitive (leaf)
+    // EMPTY_CHILD -> unused slot
+    std::array<s32, 4> children;
+
+    static constexpr s32 EMPTY_CHILD = S32_MIN;
+
+    // conservative bound of child i (contains the exact child box)
+    aabb child_box(u32 i) const noexcept {
+        return {
+            { origin.x + f32(lo[0][i]) * scale.x, origin.y + f32(lo[1][i]) * scale.y, origin.z + f32(lo[2][i]) * scale.z },
+            { origin.x + f32(hi[0][i]) * scale.x, origin.y + f32(hi[1][i]) * scale.y, origin.z + f32(hi[2][i]) * scale.z }
+        };
+    }
+};
+
+static_assert(sizeof(qbvh_node) == 64, "qbvh_node should fill exactly one cache line");
+
+// full precision 4-wide bvh node (112 bytes), reference for qbvh_node
+struct wide_bvh_node {
+    std::array<aabb, 4> boxes;
+    std::array<s32, 4> children;
+
+    static constexpr s32 EMPTY_CHILD = S32_MIN;
+
+    aabb child_box(u32 i) const noexcept {
+        return boxes[i];
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const qbvh_node& qn) {
+    os << std::format("origin: {}, scale: {}, children: ({}, {}, {}, {})", qn.origin, qn.scale, qn.children[0], qn.children[1], qn.children[2], qn.children[3]);
+    return os;
+}
+
+inline std::ostream& operator<<(std::ostream& os, const wide_bvh_node& wn) {
+    os << std::format("children: ({}, {}, {}, {})", wn.children[0], wn.children[1], wn.children[2], wn.children[3]);
+    return os;
+}
+
+namespace internal_ {
+
+// depth first traversal keeps at most 3 siblings per level above the current node plus its 4 children
+// wide nodes are never deeper than the binary nodes they are collapsed from (< BVH_MAX_DEPTH)
+constexpr usize WIDE_BVH_STACK_SIZE_ = 3 * BVH_MAX_DEPTH + 1;
+
+// ray against box in [0, t_max]
+inline bool hit_box_(const ray& r, const vec3f32& inv_direction, const aabb& b, f32 t_max) noexcept {
+    return enter_box_(r, inv_direction, b, t_max).has_value();
+}
+
+}
+
+// 4-wide bvh collapsed from a binary bvh
+// same leaves (one polygon each) and same trace() interface as bvh
+// Node: qbvh_node / wide_bvh_node (explicitly instantiated in qbvh.cpp)
+template<class Node>
+class wide_bvh {
+    std::vector<Node> nodes_;
+
+    // counters == nullptr for Count == false
+    template<bool Count>
+    std::optional<std::pair<u32, f32>> trace_(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters* counters) const;
+
+public:
+    explicit wide_bvh(const bvh& bvh);
+    // nodes in the layout of bvh::nodes() (e.g. refit copy of them)
+    explicit wide_bvh(std::span<const bvh_node> binary);
+
+    std::optional<std::pair<u32, f32>> trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max) const;
+    // same as trace(), adds the work of this call to counters
+    std::optional<std::pair<u32, f32>> trace(std::span<const vec3f32> vertices, std::span<const vec3u32> indices, const ray& r, f32 t_max, trace_counters& counters) const;
+
+    // lays nodes out depth first in traversal order (the child trace() visits first directly after its parent)
+    // leaves keep their polygon indices (reorder the binary bvh and mesh before collapsing to match leaf order)
+    void reorder();
+
+    std::span<const Node> nodes() const noexcept { return nodes_; }
+};
+
+using qbvh = wide_bvh<qbvh_node>;
+
+}
+
+template<>
+struct std::formatter<lumina::qbvh_node> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        auto iter = ctx.begin();
+        return iter;
+    }
+
+    auto format(const lumina::qbvh_node& qn, std::format_context& ctx) const {
+        return std::format_to(ctx.out(), "origin: {}, scale: {}, children: ({}, {}, {}, {})", qn.origin, qn.scale, qn.children[0], qn.children[1], qn.children[2], qn.children[3]);
+    }
+};
+
+template<>
+struct std::formatter<lumina::wide_bvh_node> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        auto iter = ctx.begin();
+        return iter;
+    }
+
+    auto format(const lumina::wide_bvh_node& wn, std::format_context& ctx) const {
+        return std::format_to(ctx.out(), "children: ({}, {}, {}, {})", wn.children[0], wn.children[1], wn.children[2], wn.children[3]);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <random>
+
+#include "base.hpp"
+#include "rng.hpp"
+#include "vector.hpp"
+
+namespace lumina {
+
+// sample generators for Monte Carlo integration
+// every sampler knows which pixel sample it is generating:
+// start_pixel_sample() selects (pixel, sample index), then each get_1d() / get_2d() consumes the next dimension
+template<class S>
+concept sampler = requires(S& s, u32 x, u32 y, u32 index) {
+    s.start_pixel_sample(x, y, index);
+    { s.get_1d() } -> std::convertible_to<f32>;
+    { s.get_2d() } -> std::convertible_to<vec2f32>;
+};
+
+namespace internal_ {
+
+// 32-bit integer hash (lowbias32)
+// reference: https://nullprogram.com/blog/2018/07/31/
+constexpr u32 hash_(u32 x) noexcept {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+constexpr u32 hash_combine_(u32 seed, u32 v) noexcept {
+    return hash_(seed ^ (v + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+}
+
+// [0, 2^32) -> [0, 1), never returns 1.0f
+constexpr f32 to_unit_f32_(u32 x) noexcept {
+    return f32(x >> 8) * 0x1p-24f;
+}
+
+constexpr u32 reverse_bits_(u32 x) noexcept {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// generator matrices of the first two Sobol' dimensions (one column per index bit)
+// dimension 0 is van der Corput, dimension 1 is the Pascal matrix mod 2
+constexpr std::array<std::array<u32, 32>, 2> sobol_matrices_ = [] {
+    std::array<std::array<u32, 32>, 2> m{};
+    m[0][0] = 0x80000000u;
+    m[1][0] = 0x80000000u;
+    for(u32 i = 1; i < 32; ++i) {
+        m[0][i] = m[0][i - 1] >> 1;
+        m[1][i] = m[1][i - 1] ^ (m[1][i - 1] >> 1);
+    }
+    return m;
+}();
+
+constexpr u32 sobol_(u32 index, u32 dimension) noexcept {
+    if(dimension == 0) {
+        return reverse_bits_(index);
+    }
+
+    u32 x{};
+    for(u32 i = 0; index != 0; index >>= 1, ++i) {
+        if(index & 1) {
+            x ^= sobol_matrices_[dimension][i];
+        }
+    }
+    return x;
+}
+
+// Brent Burley - "Practical Hash-based Owen Scrambling", 2020
+constexpr u32 laine_karras_permutation_(u32 x, u32 seed) noexcept {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+constexpr u32 nested_uniform_scramble_(u32 x, u32 seed) noexcept {
+    x = reverse_bits_(x);
+    x = laine_karras_permutation_(x, seed);
+    x = reverse_bits_(x);
+    return x;
+}
+
+}
+
+// independent uniform random numbers (plain Monte Carlo)
+// the generator is reseeded for every pixel sample, so results do not depend on the order pixels are rendered in
+template<class RandGen>
+class independent_sampler {
+    u32 seed_;
+    RandGen rng_;
+    std::uniform_real_distribution<f32> r_;
+
+public:
+    explicit independent_sampler(u64 seed) : seed_(internal_::hash_(u32(seed ^ (seed >> 32)))), rng_(seed), r_() {}
+
+    void start_pixel_sample(u32 x, u32 y, u32 index) {
+        auto pixel_seed = internal_::hash_combine_(internal_::hash_combine_(seed_, x), y);
+        rng_ = RandGen((u64(pixel_seed) << 32) | index);
+    }
+
+    f32 get_1d() {
+        return r_(rng_);
+    }
+
+    vec2f32 get_2d() {
+        auto u1 = r_(rng_);
+        auto u2 = r_(rng_);
+        return { u1, u2 };
+    }
+};
+
+// Owen-scrambled Sobol' sequence
+// each dimension (pair) is padded with an independently shuffled and scrambled 2D Sobol' sequence,
+// so every dimension keeps the (0, 2)-sequence stratification at any power-of-two sample count
+class sobol_sampler {
+    u32 seed_;
+    u32 pixel_seed_;
+    u32 index_;
+    u32 dimension_;
+
+public:
+    explicit sobol_sampler(u64 seed) noexcept : seed_(internal_::hash_(u32(seed ^ (seed >> 32)))), pixel_seed_(), index_(), dimension_() {}
+
+    void start_pixel_sample(u32 x, u32 y, u32 index) noexcept {
+        pixel_seed_ = internal_::hash_combine_(internal_::hash_combine_(seed_, x), y);
+        index_ = index;
+        dimension_ = 0;
+    }
+
+    f32 get_1d() noexcept {
+        auto dim_seed = internal_::hash_combine_(pixel_seed_, dimension_++);
+        auto i = internal_::nested_uniform_scramble_(index_, dim_seed);
+        return internal_::to_unit_f32_(internal_::nested_uniform_scramble_(internal_::sobol_(i, 0), internal_::hash_combine_(dim_seed, 0)));
+    }
+
+    vec2f32 get_2d() noexcept {
+        auto dim_seed = internal_::hash_combine_(pixel_seed_, dimension_++);
+        auto i = internal_::nested_uniform_scramble_(index_, dim_seed);
+        auto x = internal_::nested_uniform_scramble_(internal_::sobol_(i, 0), internal_::hash_combine_(dim_seed, 0));
+        auto y = internal_::nested_uniform_scramble_(internal_::sobol_(i, 1), internal_::hash_combine_(dim_seed, 1));
+        return { internal_::to_unit_f32_(x), internal_::to_unit_f32_(y) };
+    }
+};
+
+// rank-1 lattice (R2 / golden ratio sequences) with a per-pixel Cranley-Patterson rotation
+// the rotation is the R2 dither mask of the pixel coordinate, which spreads the error of neighbouring pixels as blue noise
+// reference: Martin Roberts - "The Unreasonable Effectiveness of Quasirandom Sequences", 2018
+// all arithmetic is 0.32 fixed point, so the lattice stays exact for any sample index
+class rank1_sampler {
+    // 1 / phi, (1 / phi_2, 1 / phi_2^2) in 0.32 fixed point
+    static constexpr u32 GOLDEN_ = 2654435769u;
+    static constexpr u32 R2_A1_  = 3242174889u;
+    static constexpr u32 R2_A2_  = 2447445413u;
+
+    u32 seed_;
+    u32 dither_x_;
+    u32 dither_y_;
+    u32 index_;
+    u32 dimension_;
+
+public:
+    explicit rank1_sampler(u64 seed) noexcept : seed_(internal_::hash_(u32(seed ^ (seed >> 32)))), dither_x_(), dither_y_(), index_(), dimension_() {}
+
+    void start_pixel_sample(u32 x, u32 y, u32 index) noexcept {
+        dither_x_ = x * R2_A1_ + y * R2_A2_;
+        dither_y_ = y * R2_A1_ + x * R2_A2_;
+        index_ = index;
+        dimension_ = 0;
+    }
+
+    f32 get_1d() noexcept {
+        auto shift = dither_x_ + internal_::hash_combine_(seed_, dimension_++);
+        return internal_::to_unit_f32_(index_ * GOLDEN_ + shift);
+    }
+
+    vec2f32 get_2d() noexcept {
+        auto dim_seed = internal_::hash_combine_(seed_, dimension_++);
+        auto x = index_ * R2_A1_ + dither_x_ + dim_seed;
+        auto y = index_ * R2_A2_ + dither_y_ + internal_::hash_(dim_seed);
+        return { internal_::to_unit_f32_(x), internal_::to_unit_f32_(y) };
+    }
+};
+
+// uniform numbers from either a sampler or a raw RNG (e.g. xoshiro256pp)
+template<class RandGen>
+inline f32 uniform_1d(RandGen& rng) {
+    if constexpr(sampler<RandGen>) {
+        return rng.get_1d();
+    }
+    else {
+        std::uniform_real_distribution<f32> r{};
+        return r(rng);
+    }
+}
+
+template<class RandGen>
+inline vec2f32 uniform_2d(RandGen& rng) {
+    if constexpr(sampler<RandGen>) {
+        return rng.get_2d();
+    }
+    else {
+        std::uniform_real_distribution<f32> r{};
+        auto u1 = r(rng);
+        auto u2 = r(rng);
+        return { u1, u2 };
+    }
+}
+
+}
\ No newline at end of file
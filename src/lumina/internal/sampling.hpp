@@ -1,16 +1,15 @@
 #pragma once
 
+#include "frame.hpp"
+#include "sampler.hpp"
 #include "triangle.hpp"
 
 namespace lumina {
 
 // orthonormal basis
-constexpr inline vec3f32 onb(const vec3f32& n, const vec3f32& v) {
-    vec3f32 axis = std::abs(n.x) > 0.001f ? vec3f32(0.0f, 1.0f, 0.0f) : vec3f32(1.0f, 0.0f, 0.0f);
-    auto t = normalize(cross(axis, n));
-    auto s = cross(n, t);
-
-    return normalize(s * v.x + t * v.y + n * v.z);
+// one-off transform, build a frame instead when the same n is used more than once
+inline vec3f32 onb(const vec3f32& n, const vec3f32& v) {
+    return frame(n).to_world(v);
 }
 
 // spherical coordinate system
@@ -20,13 +19,12 @@ constexpr inline vec3f32 onb(const vec3f32& n, const vec3f32& v) {
 
 // reference: https://rayspace.xyz/CG/contents/geometry_sampling_implementation/
 
-// vector n should be normalized
+// f: frame around the sampling axis
 template<class RandGen>
-inline vec3f32 sample_uniform_sphere(const vec3f32& n, RandGen& rng) {
-    std::uniform_real_distribution<f32> r{};
-
-    auto u1 = r(rng);
-    auto u2 = r(rng);
+inline vec3f32 sample_uniform_sphere(const frame& f, RandGen& rng) {
+    auto u = uniform_2d(rng);
+    auto u1 = u.x;
+    auto u2 = u.y;
 
     auto cos_theta = 1.0f - 2.0f * u1;
     auto phi = 2.0f * F32_PI * u2;
@@ -38,20 +36,19 @@ inline vec3f32 sample_uniform_sphere(const vec3f32& n, RandGen& rng) {
     auto y = sin_theta * std::sin(phi);
     auto z = cos_theta;
 
-    return onb(n, {x, y, z});
+    return f.to_world({x, y, z});
 }
 
 constexpr inline f32 sample_uniform_sphere_pdf(const vec3f32&) {
     return 1.0f / (4.0f * F32_PI);
 }
 
-// vector n should be normalized
+// f: frame around the sampling axis
 template<class RandGen>
-inline vec3f32 sample_uniform_hemisphere(const vec3f32& n, RandGen& rng) {
-    std::uniform_real_distribution<f32> r{};
-
-    auto u1 = r(rng);
-    auto u2 = r(rng);
+inline vec3f32 sample_uniform_hemisphere(const frame& f, RandGen& rng) {
+    auto u = uniform_2d(rng);
+    auto u1 = u.x;
+    auto u2 = u.y;
 
     auto cos_theta = u1;
     auto phi = 2.0f * F32_PI * u2;
@@ -62,20 +59,19 @@ inline vec3f32 sample_uniform_hemisphere(const vec3f32& n, RandGen& rng) {
     auto y = sin_theta * std::sin(phi);
     auto z = cos_theta;
 
-    return onb(n, {x, y, z});
+    return f.to_world({x, y, z});
 }
 
 constexpr inline f32 sample_uniform_hemisphere_pdf(const vec3f32&) {
     return 1.0f / (2.0f * F32_PI);
 }
 
-// vector n should be normalized
+// f: frame around the sampling axis
 template<class RandGen>
-inline vec3f32 sample_cosine_hemisphere(const vec3f32& n, RandGen& rng) {
-    std::uniform_real_distribution<f32> r{};
-
-    auto u1 = r(rng);
-    auto u2 = r(rng);
+inline vec3f32 sample_cosine_hemisphere(const frame& f, RandGen& rng) {
+    auto u = uniform_2d(rng);
+    auto u1 = u.x;
+    auto u2 = u.y;
 
     auto cos_theta = std::sqrt(u1);
     auto phi = 2.0f * F32_PI * u2;
@@ -86,15 +82,14 @@ inline vec3f32 sample_cosine_hemisphere(const vec3f32& n, RandGen& rng) {
     auto y = cos_theta * std::sin(phi);
     auto z = sin_theta;
 
-    return onb(n, {x, y, z});
+    return f.to_world({x, y, z});
 }
 
 template<class RandGen>
 inline vec3f32 sample_uniform_rectangle(const vec3f32& o, const vec3f32& a, const vec3f32& b, RandGen& rng) {
-    std::uniform_real_distribution<f32> r{};
-
-    auto u1 = r(rng);
-    auto u2 = r(rng);
+    auto u = uniform_2d(rng);
+    auto u1 = u.x;
+    auto u2 = u.y;
 
     return normalize(o + u1 * a + u2 * b);
 }
@@ -106,10 +101,9 @@ constexpr inline f32 sample_uniform_rectangle_pdf(const vec3f32& a, const vec3f3
 // o = p0, a = p1 - p0, b = p2 - p0
 template<class RandGen>
 inline vec3f32 sample_uniform_triangle(const vec3f32& o, const vec3f32& a, const vec3f32& b, RandGen& rng) {
-    std::uniform_real_distribution<f32> r{};
-
-    auto u1 = r(rng);
-    auto u2 = r(rng);
+    auto u = uniform_2d(rng);
+    auto u1 = u.x;
+    auto u2 = u.y;
 
     auto t_a = 1.0f - std::sqrt(u1);
     auto t_b = (1.0f - t_a) * u2;
@@ -124,10 +118,9 @@ constexpr inline f32 sample_uniform_triangle_pdf(const vec3f32& a, const vec3f32
 // Eric Heitz - "A Low-Distortion Map Between Triangle and Square", 2019
 template<class RandGen>
 inline vec3f32 sample_heitz_triangle(const vec3f32& p0, const vec3f32& p1, const vec3f32& p2, RandGen& rng) {
-    std::uniform_real_distribution<f32> r{};
-
-    auto u1 = r(rng);
-    auto u2 = r(rng);
+    auto u = uniform_2d(rng);
+    auto u1 = u.x;
+    auto u2 = u.y;
 
     auto t0 = 0.5f * u1;
     auto t1 = 0.5f * u2;
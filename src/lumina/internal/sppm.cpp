@@ -0,0 +1,63 @@
+#include "sppm.hpp"
+
+namespace lumina {
+
+sppm::sppm(u32 width, u32 height, const sppm_options& options) :
+    pixels_(usize(width) * height),
+    width_(width),
+    height_(height),
+    iterations_(0),
+    options_(options)
+{
+    for(auto& p : pixels_) {
+        p.radius = options_.initial_radius;
+    }
+}
+
+kdtree<u32> sppm::visible_points_(f32& max_radius) const {
+    std::vector<vec3f32> positions{};
+    std::vector<u32> indices{};
+    max_radius = 0.0f;
+    for(u32 i = 0; i < pixels_.size(); ++i) {
+        if(pixels_[i].surface) {
+            positions.push_back(pixels_[i].position);
+            indices.push_back(i);
+            max_radius = std::max(max_radius, pixels_[i].radius);
+        }
+    }
+    return kdtree<u32>(positions, std::move(indices));
+}
+
+void sppm::update_() {
+    for(auto& p : pixels_) {
+        auto m = p.m.exchange(0, std::memory_order_relaxed);
+        vec3f32 phi(p.phi[0].exchange(0.0f), p.phi[1].exchange(0.0f), p.phi[2].exchange(0.0f));
+        if(m == 0) {
+            continue;
+        }
+
+        // keep alpha of the new photons, shrink the radius so that the photon density stays the same
+        auto n = p.n + options_.alpha * f32(m);
+        auto radius = p.radius * std::sqrt(n / (p.n + f32(m)));
+        p.tau = (p.tau + p.beta * phi) * (radius * radius) / (p.radius * p.radius);
+        p.n = n;
+        p.radius = radius;
+    }
+}
+
+std::vector<vec3f32> sppm::image() const {
+    std::vector<vec3f32> image(pixels_.size());
+    if(iterations_ == 0) {
+        return image;
+    }
+
+    // photon power is normalized per iteration, so tau / (pi r^2) sums one radiance estimate per iteration
+    auto inv_iterations = 1.0f / f32(iterations_);
+    for(usize i = 0; i < pixels_.size(); ++i) {
+        const auto& p = pixels_[i];
+        image[i] = (p.emitted + p.tau / (F32_PI * p.radius * p.radius)) * inv_iterations;
+    }
+    return image;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "camera.hpp"
+#include "kdtree.hpp"
+#include "photon_map.hpp"
+
+namespace lumina {
+
+// stochastic progressive photon mapping controls
+struct sppm_options {
+    // photons traced per iteration
+    u32 photons = 1 << 18;
+    // photon paths: russian roulette after min_depth bounces, at most max_depth rays
+    u32 min_depth = 3;
+    u32 max_depth = 16;
+    // visible points and photons are on surfaces at least this rough (diffuse surfaces always), see photon_options
+    f32 min_roughness = 0.5f;
+    // gather radius of every pixel at the first iteration
+    f32 initial_radius = 0.1f;
+    // fraction of the new photons kept by each iteration, radius shrinks as sqrt((N + alpha * M) / (N + M))
+    f32 alpha = 2.0f / 3.0f;
+};
+
+// stochastic progressive photon mapping
+// every iterate() runs a camera pass (one visible point per pixel) and a photon pass splatting photons into the pixels
+// memory is constant over iterations: per-pixel statistics and a kdtree over the visible points, no photon is stored
+// reference: Toshiya Hachisuka, Henrik Wann Jensen - "Stochastic Progressive Photon Mapping", 2009
+class sppm {
+    struct pixel_ {
+        // visible point of the current iteration, no surface -> nothing to gather
+        vec3f32 position;
+        vec3f32 omega_o;
+        // throughput of the camera path to the visible point
+        vec3f32 beta;
+        std::optional<bsdf> surface;
+
+        // emission seen by camera paths, sum over iterations
+        vec3f32 emitted;
+
+        // progressive statistics: gather radius, accumulated photon count and flux
+        f32 radius{};
+        f32 n{};
+        vec3f32 tau;
+
+        // photons of the current iteration
+        std::array<std::atomic<f32>, 3> phi;
+        std::atomic<u32> m;
+    };
+
+    std::vector<pixel_> pixels_;
+    u32 width_;
+    u32 height_;
+    u32 iterations_;
+    sppm_options options_;
+
+    photon_options photon_options_() const noexcept {
+        return { .photons = options_.photons, .min_depth = options_.min_depth, .max_depth = options_.max_depth, .min_roughness = options_.min_roughness };
+    }
+
+    // kdtree over pixels with a visible point, payload is the pixel index
+    kdtree<u32> visible_points_(f32& max_radius) const;
+
+    // radius and flux update from the photons of the iteration
+    void update_();
+
+public:
+    sppm(u32 width, u32 height, const sppm_options& options = {});
+
+    // one camera pass and one photon pass, seed of the photon pass should differ between calls
+    // Sampler: camera and camera path sampling (sobol_sampler etc.), sample index is the iteration
+    template<class Sampler, triangle_accelerator Accelerator>
+    void iterate(const Accelerator& bvh, const mesh& mesh, const camera& cam, const path_options& options, u64 seed) {
+        auto closest_hit = internal_::closest_hit_of_(bvh, mesh);
+        auto photon_options = photon_options_();
+
+        // camera pass: rows on all hardware threads
+        std::atomic<u32> next{};
+        auto thread_count = std::max<u32>(1, std::thread::hardware_concurrency());
+        std::vector<std::thread> threads{};
+        for(u32 t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&] {
+                Sampler sampler(seed);
+                for(auto y = next++; y < height_; y = next++) {
+                    for(u32 x = 0; x < width_; ++x) {
+                        auto& pixel = pixels_[y * width_ + x];
+                        pixel.surface.reset();
+
+                        sampler.start_pixel_sample(x, y, iterations_);
+                        auto gather = [&](const vec3f32& p, const vec3f32& omega_o, const bsdf& surface, const vec3f32& alpha) {
+                            pixel.position = p;
+                            pixel.omega_o = omega_o;
+                            pixel.beta = alpha;
+                            pixel.surface = surface;
+                            return vec3f32{};
+                        };
+                        pixel.emitted += internal_::trace_path_(cam.generate_ray(x, y, sampler), closest_hit, sampler, options, internal_::stop_at_gathered_(photon_options, gather)).radiance;
+                    }
+                }
+            });
+        }
+        for(auto& t : threads) {
+            t.join();
+        }
+
+        // photon pass: photons within the radius of a visible point add bsdf * power to its pixel
+        f32 max_radius{};
+        auto tree = visible_points_(max_radius);
+        internal_::for_each_photon_(bvh, mesh, photon_options, seed, [&](u32, const vec3f32& x, const vec3f32& omega_i, const vec3f32& power) {
+            tree.radius_search(x, max_radius, [&](u32 index, f32 distance2) {
+                auto& pixel = pixels_[index];
+                if(distance2 > pixel.radius * pixel.radius) {
+                    return;
+                }
+                auto flux = pixel.surface->eval(pixel.omega_o, omega_i) * power;
+                pixel.phi[0].fetch_add(flux.r, std::memory_order_relaxed);
+                pixel.phi[1].fetch_add(flux.g, std::memory_order_relaxed);
+                pixel.phi[2].fetch_add(flux.b, std::memory_order_relaxed);
+                pixel.m.fetch_add(1, std::memory_order_relaxed);
+            });
+        });
+
+        update_();
+        ++iterations_;
+    }
+
+    // current estimate, row major
+    std::vector<vec3f32> image() const;
+
+    u32 iterations() const noexcept { return iterations_; }
+
+    usize resident_bytes() const noexcept { return pixels_.size() * sizeof(pixel_); }
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include <algorithm>
+#include <format>
+#include <iostream>
+
+#include "statistics.hpp"
+
+namespace lumina {
+
+void report_statistics(std::span<const render_statistics> threads) {
+    render_statistics total{};
+    for(const auto& t : threads) {
+        total += t;
+    }
+
+    auto rays = f64(std::max<u64>(1, total.rays));
+    std::cout << std::format("# of samples: {}, # of rays: {}, # of hits: {} ({:.1f}%)\n", total.samples, total.rays, total.hits, 100.0 * f64(total.hits) / rays);
+    std::cout << std::format("per ray: {:.2f} nodes, {:.2f} box tests, {:.2f} triangle tests\n", f64(total.traversal.nodes) / rays, f64(total.traversal.boxes) / rays, f64(total.traversal.triangles) / rays);
+
+    std::cout << "path depth histogram:\n";
+    auto samples = f64(std::max<u64>(1, total.samples));
+    for(u32 i = 0; i < PATH_DEPTH_BINS; ++i) {
+        if(total.path_depths[i] == 0) {
+            continue;
+        }
+        std::cout << std::format("  {:>3}{}: {:>12} ({:.2f}%)\n", i, i + 1 == PATH_DEPTH_BINS ? "+" : " ", total.path_depths[i], 100.0 * f64(total.path_depths[i]) / samples);
+    }
+
+    for(size_t i = 0; i < threads.size(); ++i) {
+        const auto& t = threads[i];
+        std::cout << std::format("thread {:>3}: {:>10} samples, {:.1f} samples/sec\n", i, t.samples, t.seconds > 0.0 ? f64(t.samples) / t.seconds : 0.0);
+    }
+    std::cout << std::flush;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <span>
+
+#include "base.hpp"
+
+namespace lumina {
+
+// render statistics are compiled in with LUMINA_STATISTICS (cmake -DLUMINA_STATISTICS=ON)
+// without it every counter update is discarded at compile time
+#if defined(LUMINA_STATISTICS)
+constexpr bool STATISTICS_ENABLED = true;
+#else
+constexpr bool STATISTICS_ENABLED = false;
+#endif
+
+// work done by trace() calls
+struct trace_counters {
+    // nodes popped from the traversal stack
+    u64 nodes{};
+    // ray-box tests
+    u64 boxes{};
+    // ray-triangle tests
+    u64 triangles{};
+};
+
+// path lengths >= PATH_DEPTH_BINS - 1 share the last bin
+constexpr u32 PATH_DEPTH_BINS = 33;
+
+// counters of one render thread
+struct render_statistics {
+    trace_counters traversal{};
+    // closest hit queries of the path tracer
+    u64 rays{};
+    u64 hits{};
+    // traced paths (camera samples)
+    u64 samples{};
+    // path length -> paths
+    std::array<u64, PATH_DEPTH_BINS> path_depths{};
+    // busy time of the thread, set by the render loop
+    f64 seconds{};
+
+    render_statistics& operator+=(const render_statistics& s) noexcept {
+        traversal.nodes += s.traversal.nodes;
+        traversal.boxes += s.traversal.boxes;
+        traversal.triangles += s.traversal.triangles;
+        rays += s.rays;
+        hits += s.hits;
+        samples += s.samples;
+        for(u32 i = 0; i < PATH_DEPTH_BINS; ++i) {
+            path_depths[i] += s.path_depths[i];
+        }
+        seconds += s.seconds;
+        return *this;
+    }
+};
+
+// counters of the calling thread, written without synchronization
+// collect them from each thread after its work (e.g. stats[thread] = thread_statistics()) and report after join
+inline render_statistics& thread_statistics() noexcept {
+    thread_local render_statistics statistics{};
+    return statistics;
+}
+
+// totals, per ray averages, path depth histogram and samples per second of each thread
+void report_statistics(std::span<const render_statistics> threads);
+
+}
\ No newline at end of file
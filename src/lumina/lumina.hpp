@@ -2,20 +2,38 @@
 
 #include "internal/aabb.hpp"
 #include "internal/base.hpp"
+#include "internal/bsdf.hpp"
 #include "internal/bvh.hpp"
 #include "internal/camera.hpp"
+#include "internal/compressed_mesh.hpp"
+#include "internal/denoise.hpp"
+#include "internal/film.hpp"
+#include "internal/frame.hpp"
+#include "internal/heatmap.hpp"
+#include "internal/image.hpp"
+#include "internal/integrator.hpp"
 #include "internal/intersect.hpp"
 #include "internal/kdtree.hpp"
+#include "internal/mapped_file.hpp"
 #include "internal/material.hpp"
 #include "internal/matrix.hpp"
+#include "internal/memory.hpp"
 #include "internal/mesh.hpp"
+#include "internal/mesh_binary.hpp"
 #include "internal/microfacet.hpp"
 #include "internal/obj.hpp"
+#include "internal/octahedral.hpp"
+#include "internal/photon_map.hpp"
+#include "internal/preview.hpp"
+#include "internal/qbvh.hpp"
 #include "internal/ray.hpp"
 #include "internal/ref_idx.hpp"
 #include "internal/rng.hpp"
+#include "internal/sampler.hpp"
 #include "internal/sampling.hpp"
 #include "internal/scene.hpp"
 #include "internal/sphere.hpp"
+#include "internal/sppm.hpp"
+#include "internal/statistics.hpp"
 #include "internal/triangle.hpp"
 #include "internal/vector.hpp"
\ No newline at end of file
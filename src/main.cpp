@@ -1,10 +1,12 @@
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <fstream>
 #include <format>
 #include <iostream>
 #include <mutex>
 #include <random>
 #include <semaphore>
+#include <string_view>
 #include <thread>
 
 #include <cstdint>
@@ -28,87 +30,295 @@
 constexpr lumina::f32 ASPECT_RATIO = 16.0f / 9.0f;
 constexpr lumina::u32 IMAGE_WIDTH  = 512;
 constexpr lumina::u32 IMAGE_HEIGHT = (IMAGE_WIDTH / ASPECT_RATIO < 1) ? 1 : IMAGE_WIDTH / ASPECT_RATIO;
+constexpr lumina::f32 FOV = 90.0f;
 #if defined(DEBUG)
-constexpr lumina::u32 SAMPLES  = 1;
-constexpr lumina::f32 RR_DECAY = 0.5f;
+constexpr lumina::u32 SAMPLES   = 1;
+constexpr lumina::u32 MIN_DEPTH = 1;
+constexpr lumina::u32 MAX_DEPTH = 8;
+constexpr lumina::u32 PHOTONS        = 1 << 18;
+constexpr lumina::u32 PHOTON_SAMPLES = 1;
+constexpr lumina::u32 SPPM_ITERATIONS = 2;
+constexpr lumina::u32 SPPM_PHOTONS    = 1 << 16;
+constexpr lumina::u32 DENOISE_SAMPLES = 4;
 #else
-constexpr lumina::u32 SAMPLES  = 2048;
-constexpr lumina::f32 RR_DECAY = 0.9f;
+constexpr lumina::u32 SAMPLES   = 2048;
+constexpr lumina::u32 MIN_DEPTH = 3;
+constexpr lumina::u32 MAX_DEPTH = 32;
+constexpr lumina::u32 PHOTONS        = 1 << 22;
+constexpr lumina::u32 PHOTON_SAMPLES = 16;
+constexpr lumina::u32 SPPM_ITERATIONS = 256;
+constexpr lumina::u32 SPPM_PHOTONS    = 1 << 20;
+constexpr lumina::u32 DENOISE_SAMPLES = 64;
 #endif
 
-// from: https://rayspace.xyz/CG/contents/path_tracing_implementation/
-// with russian roulette
-template<class RandGen>
-lumina::vec3f32 trace_ray(const lumina::ray& r, const lumina::bvh& bvh, const lumina::mesh& mesh, RandGen& rng) {
-    constexpr lumina::f32 eps = 0.0001f;
-    std::uniform_real_distribution<lumina::f32> xi{};
+// pixels of a task, rendered into a film_tile of one thread
+constexpr lumina::u32 TILE_SIZE = 16;
 
-    lumina::vec3f32 i_j{};
-    lumina::vec3f32 alpha = lumina::vec3f32(1.0f);
+// pixel reconstruction filter
+constexpr lumina::film_filter FILTER{.type = lumina::film_filter_type::gaussian, .radius = 1.5f};
 
-    lumina::f32 t_max = lumina::F32_MAX;
-    lumina::f32 p_rr = 1.0f;
+// interactive preview: rolling image file, restarted when the config file changes
+constexpr const char* PREVIEW_CONFIG = "preview.cfg";
+constexpr const char* PREVIEW_FILE = "preview.png";
+// resolution divisors of the first passes after every (re)start, 1 spp each, full resolution passes accumulate
+constexpr std::array<lumina::u32, 3> PREVIEW_SCALES = {4, 2, 1};
+constexpr lumina::u32 PREVIEW_MAX_SAMPLES = 1024;
 
-    lumina::vec3f32 background = lumina::vec3f32(0.2f);
+// sample generator for camera and path sampling
+// lumina::independent_sampler<lumina::xoshiro256pp> / lumina::sobol_sampler / lumina::rank1_sampler
+using sampler_type = lumina::sobol_sampler;
 
-    auto ray = r;
-
-    while(true) {
-        auto test_result = bvh.trace(mesh.vertices, mesh.vertex_indices, ray, t_max);
+// full range radiance (test.exr) and a clamped 8-bit preview (test.png)
+void save_image(const std::vector<lumina::vec3f32>& pixels) {
+    if(!lumina::save_exr("test.exr", pixels, IMAGE_WIDTH, IMAGE_HEIGHT) || !lumina::save_png("test.png", pixels, IMAGE_WIDTH, IMAGE_HEIGHT)) {
+        std::clog << "failed to save the image. exit." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
 
-        if(!test_result) {
-            i_j += alpha * background;
-            break;
+// auxiliary outputs: colours as test_*.exr, scalars (depth, primitive id, variance, sample count) as 32-bit test_*.pfm
+void save_aovs(const lumina::film& film) {
+    auto gray = [](const auto& values) {
+        std::vector<lumina::vec3f32> pixels(values.size());
+        for(lumina::usize i = 0; i < values.size(); ++i) {
+            pixels[i] = lumina::vec3f32(lumina::f32(values[i]));
         }
+        return pixels;
+    };
+    auto ids = film.primitive_ids();
+    std::vector<lumina::f32> id_values(ids.size());
+    for(lumina::usize i = 0; i < ids.size(); ++i) {
+        // exact below 2^24 polygons, -1 where the ray escaped
+        id_values[i] = ids[i] == lumina::U32_MAX ? -1.0f : lumina::f32(ids[i]);
+    }
 
-        auto [index_index, t] = *test_result;
-        const auto& material = mesh.material(index_index);
-
-        auto x = ray[t];
-        auto n = mesh.normal(ray[t], index_index);
-        n = dot(ray.direction, n) > 0.0f ? -n : n;
-        auto omega_o = -ray.direction;
+    if(!lumina::save_exr("test_albedo.exr", film.albedo(), IMAGE_WIDTH, IMAGE_HEIGHT)
+        || !lumina::save_exr("test_normal.exr", film.normal(), IMAGE_WIDTH, IMAGE_HEIGHT)
+        || !lumina::save_pfm("test_depth.pfm", gray(film.depth()), IMAGE_WIDTH, IMAGE_HEIGHT)
+        || !lumina::save_pfm("test_primitive.pfm", gray(id_values), IMAGE_WIDTH, IMAGE_HEIGHT)
+        || !lumina::save_pfm("test_variance.pfm", gray(film.variance()), IMAGE_WIDTH, IMAGE_HEIGHT)
+        || !lumina::save_pfm("test_samples.pfm", gray(film.sample_counts()), IMAGE_WIDTH, IMAGE_HEIGHT)) {
+        std::clog << "failed to save the auxiliary outputs. exit." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
 
-        auto [m, omega_i, pdf_val] = lumina::sample_ggx(omega_o, n, material.roughness, rng);
+// denoised image as test_denoised.exr / .png, variance is estimated spatially at 1 spp
+void save_denoised(const lumina::film& film, lumina::u32 samples) {
+    auto start = std::chrono::steady_clock::now();
+    auto pixels = lumina::denoise(film.image(), film.albedo(), film.normal(), samples > 1 ? film.variance() : std::vector<lumina::f32>{}, IMAGE_WIDTH, IMAGE_HEIGHT);
+    std::cout << std::format("\ndenoising time: {:.3f} sec", std::chrono::duration<lumina::f64>(std::chrono::steady_clock::now() - start).count()) << std::endl;
 
-        if(material.emission.norm() != 0.0f) {
-            i_j += alpha * material.emission;
-        }
+    if(!lumina::save_exr("test_denoised.exr", pixels, IMAGE_WIDTH, IMAGE_HEIGHT) || !lumina::save_png("test_denoised.png", pixels, IMAGE_WIDTH, IMAGE_HEIGHT)) {
+        std::clog << "failed to save the denoised image. exit." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
 
-        alpha *= material.albedo;
+// startup memory: growth of resident memory while loading should match the mesh itself (single resident copy)
+// peak also contains transient memory of loader (mapped .obj file)
+void report_memory(const lumina::mesh& mesh, std::optional<lumina::usize> resident_before) {
+    constexpr auto MB = 1.0 / (1 << 20);
+    auto resident_after = lumina::current_resident_bytes();
+    auto peak = lumina::peak_resident_bytes();
+
+    std::cout << std::format("mesh memory: {:.1f} MB", lumina::f64(mesh.resident_bytes()) * MB);
+    if(resident_before && resident_after) {
+        auto growth = lumina::f64(*resident_after) - lumina::f64(*resident_before);
+        std::cout << std::format(", resident growth while loading: {:.1f} MB ({:.2f}x mesh)", growth * MB, growth / lumina::f64(std::max<lumina::usize>(1, mesh.resident_bytes())));
+    }
+    if(peak) {
+        std::cout << std::format(", peak resident: {:.1f} MB", lumina::f64(*peak) * MB);
+    }
+    std::cout << std::endl;
+}
 
-        p_rr *= RR_DECAY;
-        if(xi(rng) >= p_rr) {
-            break;
-        }
+// per pixel cost as false colour images next to test.png, full scale = 99th percentile
+void save_heatmap(const std::filesystem::path& path, const char* quantity, const std::vector<lumina::f64>& values) {
+    auto scale = lumina::heatmap_scale(values);
+    if(!lumina::save_png(path, lumina::heatmap(values, scale), IMAGE_WIDTH, IMAGE_HEIGHT)) {
+        std::exit(EXIT_FAILURE);
+    }
+    std::cout << std::format("{}: {} per sample, full scale {:.1f}", path.string(), quantity, scale) << std::endl;
+}
 
-        ray = lumina::ray(x + n * eps, omega_i);
+// stochastic progressive photon mapping: SPPM_ITERATIONS x (camera pass + SPPM_PHOTONS photons), memory does not grow with iterations
+template<class Accelerator>
+void render_sppm(const Accelerator& bvh, const lumina::mesh& mesh, const lumina::camera& cam, std::random_device& seed) {
+    auto time_start = std::chrono::steady_clock::now();
 
-        alpha *= 1.0f / p_rr;
+    lumina::sppm renderer(IMAGE_WIDTH, IMAGE_HEIGHT, {.photons = SPPM_PHOTONS, .min_depth = MIN_DEPTH, .max_depth = MAX_DEPTH});
+    lumina::path_options options{.min_depth = MIN_DEPTH, .max_depth = MAX_DEPTH};
+    for(lumina::u32 i = 0; i < SPPM_ITERATIONS; ++i) {
+        renderer.iterate<sampler_type>(bvh, mesh, cam, options, (lumina::u64(seed()) << 32) | seed());
+        std::clog << std::format("\rsppm iteration: {:>4}/{:>4}", i + 1, SPPM_ITERATIONS) << std::flush;
     }
 
-    return i_j;
+    save_image(renderer.image());
+
+    auto elapsed = std::chrono::duration<lumina::f64>(std::chrono::steady_clock::now() - time_start).count();
+    std::clog << std::format("\nfinished. elapsed time: {:.1f} sec, {:.2f} sec per iteration, sppm memory: {:.1f} MB", elapsed, elapsed / SPPM_ITERATIONS, lumina::f64(renderer.resident_bytes()) / (1 << 20)) << std::endl;
 }
 
-void save_ppm(const std::filesystem::path& path, const std::vector<lumina::vec3f32>& pixels) {
-    std::ofstream ofs(path);
-    if(ofs.fail()) {
-        std::clog << std::format("failed to create file: {}. exit.", "test.ppm") << std::endl;
+// progressive preview into PREVIEW_FILE (replaced by rename, so readers never see a partial file)
+// camera and materials are overridden by PREVIEW_CONFIG (written with the current parameters if missing)
+// every change of the file restarts accumulation, a running pass is abandoned at the next tile
+template<class Accelerator>
+void render_preview(const Accelerator& bvh, lumina::mesh& mesh, const lumina::preview_config& base, std::chrono::steady_clock::time_point launch) {
+    if(!std::filesystem::exists(PREVIEW_CONFIG) && !lumina::save_preview_config(PREVIEW_CONFIG, base)) {
         std::exit(EXIT_FAILURE);
     }
+    std::cout << std::format("preview: edit {} to move the camera or change materials, {} is rewritten after every pass", PREVIEW_CONFIG, PREVIEW_FILE) << std::endl;
+
+    // polls the modification time, the first pass waits for nothing
+    std::atomic<bool> changed{true};
+    std::jthread watcher([&](std::stop_token stop) {
+        std::error_code error{};
+        auto last = std::filesystem::last_write_time(PREVIEW_CONFIG, error);
+        while(!stop.stop_requested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            auto time = std::filesystem::last_write_time(PREVIEW_CONFIG, error);
+            if(!error && time != last) {
+                last = time;
+                changed = true;
+            }
+        }
+    });
 
-    ofs << std::format("P3\n{} {}\n255\n", IMAGE_WIDTH, IMAGE_HEIGHT);
+    // one sample per pixel of target, false if abandoned because the config changed
+    auto thread_count = std::max<lumina::u32>(1, std::thread::hardware_concurrency());
+    auto render_pass = [&](lumina::film& target, const lumina::camera& cam, lumina::u32 sample) {
+        auto tiles_x = (target.width() + TILE_SIZE - 1) / TILE_SIZE;
+        auto tiles = tiles_x * ((target.height() + TILE_SIZE - 1) / TILE_SIZE);
+        std::atomic<lumina::u32> next{};
+        std::vector<std::thread> threads{};
+        for(lumina::u32 t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&] {
+                sampler_type sampler(0);
+                for(auto i = next++; i < tiles && !changed; i = next++) {
+                    auto tile = target.tile(i % tiles_x * TILE_SIZE, i / tiles_x * TILE_SIZE, (i % tiles_x + 1) * TILE_SIZE, (i / tiles_x + 1) * TILE_SIZE);
+                    for(auto y = tile.y0(); y < tile.y1(); ++y) {
+                        for(auto x = tile.x0(); x < tile.x1(); ++x) {
+                            sampler.start_pixel_sample(x, y, sample);
+                            auto position = lumina::camera::sample_position(x, y, sampler);
+                            auto result = lumina::trace_ray(cam.generate_ray(position), bvh, mesh, sampler, {.min_depth = MIN_DEPTH, .max_depth = MAX_DEPTH});
+                            tile.add_sample(x, y, position, result.radiance, result.first_hit);
+                        }
+                    }
+                    target.merge(tile);
+                }
+            });
+        }
+        for(auto& t : threads) {
+            t.join();
+        }
+        return !changed;
+    };
+
+    auto config = base;
+    lumina::film film(IMAGE_WIDTH, IMAGE_HEIGHT, {.filter = FILTER});
+    lumina::u32 pass{};
+    auto restart = std::chrono::steady_clock::now();
+    auto first_image = true;
+    while(true) {
+        if(changed.exchange(false)) {
+            // parameters missing from the file fall back to main.cpp, an invalid file keeps the last ones and the samples
+            auto next = base;
+            if(!lumina::load_preview_config(PREVIEW_CONFIG, next)) {
+                continue;
+            }
+            config = std::move(next);
+            for(const auto& [name, material] : config.materials) {
+                mesh.add_material(name, material);
+            }
+            film.clear();
+            pass = 0;
+            restart = std::chrono::steady_clock::now();
+        }
 
-    for(const auto& p : pixels) {
-        ofs << std::format("{} {} {}\n", lumina::u8(p.r * 255.999f), lumina::u8(p.g * 255.999f), lumina::u8(p.b * 255.999f));
-    }
+        auto scale = PREVIEW_SCALES[std::min<lumina::usize>(pass, PREVIEW_SCALES.size() - 1)];
+        // full resolution samples including this pass, 0 while reduced resolution passes run
+        auto full_resolution = pass >= PREVIEW_SCALES.size() - 1;
+        auto samples = full_resolution ? pass + 2 - lumina::u32(PREVIEW_SCALES.size()) : 0;
+        if(samples > PREVIEW_MAX_SAMPLES) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+
+        // reduced resolution passes are not accumulated, their pixels are repeated to the full size
+        std::vector<lumina::vec3f32> pixels{};
+        if(scale > 1) {
+            lumina::film low(IMAGE_WIDTH / scale, IMAGE_HEIGHT / scale, {.filter = FILTER});
+            if(!render_pass(low, lumina::camera(config.from, config.at, config.up, config.fov, low.width(), low.height()), 0)) {
+                continue;
+            }
+            auto low_pixels = low.image();
+            pixels.resize(lumina::usize(IMAGE_WIDTH) * IMAGE_HEIGHT);
+            for(lumina::u32 y = 0; y < IMAGE_HEIGHT; ++y) {
+                for(lumina::u32 x = 0; x < IMAGE_WIDTH; ++x) {
+                    pixels[y * IMAGE_WIDTH + x] = low_pixels[std::min(y / scale, low.height() - 1) * low.width() + std::min(x / scale, low.width() - 1)];
+                }
+            }
+        }
+        else {
+            if(!render_pass(film, lumina::camera(config.from, config.at, config.up, config.fov, IMAGE_WIDTH, IMAGE_HEIGHT), samples - 1)) {
+                continue;
+            }
+            pixels = film.image();
+        }
 
-    ofs.close();
+        if(!lumina::save_png("preview.tmp.png", pixels, IMAGE_WIDTH, IMAGE_HEIGHT)) {
+            std::exit(EXIT_FAILURE);
+        }
+        std::error_code error{};
+        std::filesystem::rename("preview.tmp.png", PREVIEW_FILE, error);
+        if(error) {
+            std::clog << std::format("failed to replace {}: {}", PREVIEW_FILE, error.message()) << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if(first_image) {
+            first_image = false;
+            std::cout << std::format("time to first image: {:.3f} sec", std::chrono::duration<lumina::f64>(now - launch).count()) << std::endl;
+        }
+        std::clog << std::format("\rpreview: 1/{} resolution, {:>4} spp, {:.2f} sec since restart ", scale, scale > 1 ? 1 : samples, std::chrono::duration<lumina::f64>(now - restart).count()) << std::flush;
+        ++pass;
+    }
 }
 
 int main(int argc, const char* argv[]) {
+    auto launch = std::chrono::steady_clock::now();
+
     std::cout << std::format("build type: {}", BUILD_TYPE) << std::endl;
 
+    // --heatmap: also record traversal steps, triangle tests and time of every pixel (path tracing only)
+    // --photon: photon mapping (PHOTONS photons, PHOTON_SAMPLES samples per pixel) instead of path tracing
+    // --sppm: stochastic progressive photon mapping (SPPM_ITERATIONS iterations of SPPM_PHOTONS photons) instead of path tracing
+    // --aov: also write albedo, normal, depth, primitive id, variance and sample count of every pixel (not for --sppm)
+    // --denoise: DENOISE_SAMPLES samples per pixel, filtered with albedo / normal guides into test_denoised.exr / .png (not for --sppm)
+    // --preview: interactive progressive preview into PREVIEW_FILE, camera and materials are read from PREVIEW_CONFIG while running
+    auto heatmap = false;
+    auto photon = false;
+    auto sppm = false;
+    auto aov = false;
+    auto denoise = false;
+    auto preview = false;
+    for(auto i = 1; i < argc; ++i) {
+        preview |= std::string_view(argv[i]) == "--preview";
+        heatmap |= std::string_view(argv[i]) == "--heatmap";
+        aov |= std::string_view(argv[i]) == "--aov";
+        denoise |= std::string_view(argv[i]) == "--denoise";
+        photon |= std::string_view(argv[i]) == "--photon";
+        sppm |= std::string_view(argv[i]) == "--sppm";
+    }
+    // traversal counters are only threaded through the path tracer, photon mapping would write empty heatmaps
+    if(heatmap && (photon || sppm)) {
+        std::clog << "--heatmap is for path tracing, it cannot be combined with --photon / --sppm. exit." << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto samples = photon ? PHOTON_SAMPLES : denoise ? DENOISE_SAMPLES : SAMPLES;
+
     std::random_device seed{};
     lumina::xoshiro256pp rng0(seed());
 
@@ -116,65 +326,131 @@ int main(int argc, const char* argv[]) {
         {1.0f, 1.0f, -1.0f},
         {0.0f, 0.7f, -0.5f},
         {0.0f, 1.0f, 0.0f},
-        90.0f, IMAGE_WIDTH, IMAGE_HEIGHT
+        FOV, IMAGE_WIDTH, IMAGE_HEIGHT
     );
 
-    auto [vertices, texcoords, normals, vertex_indices, texcoord_indices, normal_indices, mesh_groups] = lumina::load_obj("../asset/mori_knob/mori_knob.obj");
-    lumina::mesh mesh(std::move(vertices), std::move(texcoords), std::move(normals), std::move(vertex_indices), std::move(texcoord_indices), std::move(normal_indices), std::move(mesh_groups));
+    auto resident_before = lumina::current_resident_bytes();
+
+    // converted binary mesh (lumina_convert) is mapped without parsing, otherwise parse .obj
+    // the binary is ignored once the .obj changed after the conversion
+    auto mesh = [] {
+        if(auto binary = lumina::load_mesh_binary("../asset/mori_knob/mori_knob.lmesh", "../asset/mori_knob/mori_knob.obj")) {
+            return std::move(*binary);
+        }
+        return lumina::mesh(lumina::load_obj_parallel("../asset/mori_knob/mori_knob.obj"));
+    }();
     mesh.add_material("BackGroundMat", lumina::material{.albedo = {0.8f}, .emission = {0.0f}, .roughness = 0.2f, .refractive_index = 0.0f});
     mesh.add_material("InnerMat", lumina::material{.albedo = {0.8f, 0.0f, 0.0f}, .emission = {0.0f}, .roughness = 0.0f, .refractive_index = 0.0f});
-    mesh.add_material("LTELogo", lumina::material{.albedo = {0.0f, 0.8f, 0.0f}, .emission = {0.0f, 0.8f, 0.0f}, .roughness = 1.0f, .refractive_index = 0.0f});
-    mesh.add_material("Material", lumina::material{.albedo = {1.0f}, .emission = {1.0f}, .roughness = 1.0f, .refractive_index = 0.0f});
+    mesh.add_material("LTELogo", lumina::material{.albedo = {0.0f, 0.8f, 0.0f}, .emission = {0.0f, 0.8f, 0.0f}, .roughness = 1.0f, .refractive_index = 0.0f, .type = lumina::material_type::diffuse});
+    mesh.add_material("Material", lumina::material{.albedo = {1.0f}, .emission = {1.0f}, .roughness = 1.0f, .refractive_index = 0.0f, .type = lumina::material_type::diffuse});
     mesh.add_material("OuterMat", lumina::material{.albedo = {1.0f}, .emission = {0.0f}, .roughness = 0.0f, .refractive_index = 0.0f});
     mesh.statistics();
+    report_memory(mesh, resident_before);
 
     std::cout << std::format("possible # of threads = {}", std::thread::hardware_concurrency()) << std::endl;
 
-    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices);
+    // spatial splits for the enlarged light quad and the background, which overlap everything otherwise
+    // the preview starts sooner with the faster binned sah build
+    lumina::bvh bvh(mesh.vertices, mesh.vertex_indices, {.split = preview ? lumina::bvh_split::sah : lumina::bvh_split::spatial});
+    bvh.statistics();
+    // depth-first node layout, polygons in leaf order
+    // an .lmesh from lumina_convert is already in the leaf order of the spatial split build and stays mapped
+    mesh.reorder_polygons(bvh.reorder());
+
+    if(preview) {
+        render_preview(bvh, mesh, {.from = cam.from, .at = cam.at, .up = cam.up, .fov = FOV, .materials = mesh.mat_info}, launch);
+        return 0;
+    }
+
+    if(sppm) {
+        render_sppm(bvh, mesh, cam, seed);
+        return 0;
+    }
 
     auto time_start = std::chrono::steady_clock::now();
 
-    std::vector<lumina::vec3f32> pixels(IMAGE_WIDTH * IMAGE_HEIGHT, 0.0f);
+    // photon tracing pass before the camera pass, empty map for path tracing
+    auto photon_map = photon ? lumina::trace_photons(bvh, mesh, {.photons = PHOTONS, .min_depth = MIN_DEPTH, .max_depth = MAX_DEPTH}, seed()) : lumina::photon_map({}, 0, {});
+    if(photon) {
+        photon_map.statistics();
+        std::cout << std::format("photon tracing time: {:.2f} sec", std::chrono::duration<lumina::f64>(std::chrono::steady_clock::now() - time_start).count()) << std::endl;
+    }
+
+    lumina::film film(IMAGE_WIDTH, IMAGE_HEIGHT, {.filter = FILTER, .aovs = {.albedo = aov || denoise, .normal = aov || denoise, .depth = aov, .primitive_id = aov, .variance = aov || denoise, .sample_count = aov}});
+    std::vector<lumina::f64> heat_nodes(heatmap ? IMAGE_WIDTH * IMAGE_HEIGHT : 0);
+    std::vector<lumina::f64> heat_triangles(heatmap ? IMAGE_WIDTH * IMAGE_HEIGHT : 0);
+    std::vector<lumina::f64> heat_ns(heatmap ? IMAGE_WIDTH * IMAGE_HEIGHT : 0);
 
     auto thread_count = std::max<lumina::u32>(1, std::thread::hardware_concurrency());
     // auto thread_count = 1;
     std::vector<std::thread> threads{};
     std::queue<std::pair<lumina::u32, lumina::u32>> task_queue{};
-    for(auto y = 0; y < IMAGE_HEIGHT; ++y) {
-        for(auto x = 0; x < IMAGE_WIDTH; ++x) {
+    for(lumina::u32 y = 0; y < IMAGE_HEIGHT; y += TILE_SIZE) {
+        for(lumina::u32 x = 0; x < IMAGE_WIDTH; x += TILE_SIZE) {
             task_queue.push(std::make_pair(x, y));
         }
     }
 
-    auto total_pixels = task_queue.size();
+    auto total_tiles = task_queue.size();
+    auto total_pixels = lumina::usize(IMAGE_WIDTH) * IMAGE_HEIGHT;
 
     std::mutex queue_lock{};
 
+    // sum of path lengths for statistics
+    std::atomic<lumina::u64> total_length{};
+    // counters of each thread (LUMINA_STATISTICS), each thread writes its own slot
+    std::vector<lumina::render_statistics> thread_statistics(thread_count);
+
     for(auto i = 0; i < thread_count; ++i) {
         threads.push_back(
             std::thread(
-                [&](std::random_device::result_type seed) {
-                    lumina::xoshiro256pp rng(seed);
+                [&, i](std::random_device::result_type seed) {
+                    sampler_type sampler(seed);
+                    lumina::u64 length{};
+                    auto thread_start = std::chrono::steady_clock::now();
 
                     while(true) {
                         queue_lock.lock();
                         if(task_queue.empty()) {
                             queue_lock.unlock();
+                            total_length += length;
+                            if constexpr(lumina::STATISTICS_ENABLED) {
+                                thread_statistics[i] = lumina::thread_statistics();
+                                thread_statistics[i].seconds = std::chrono::duration<lumina::f64>(std::chrono::steady_clock::now() - thread_start).count();
+                            }
                             break;
                         }
-                        auto [x, y] = task_queue.front();
+                        auto [x0, y0] = task_queue.front();
                         task_queue.pop();
-                        std::clog << std::format("\rprogress: {:.2f}% ({:>6}/{:>6})", lumina::f32(total_pixels - task_queue.size()) / lumina::f32(total_pixels) * 100.0f, total_pixels - task_queue.size(), total_pixels) << std::flush;
+                        std::clog << std::format("\rprogress: {:.2f}% ({:>4}/{:>4} tiles)", lumina::f32(total_tiles - task_queue.size()) / lumina::f32(total_tiles) * 100.0f, total_tiles - task_queue.size(), total_tiles) << std::flush;
                         queue_lock.unlock();
-                        
-                        lumina::vec3f32 pixel{};
-                        for(lumina::u32 s = 0; s < SAMPLES; ++s) {
-                            auto ray = cam.generate_ray(x, y, rng);
 
-                            pixel += lumina::min(trace_ray(ray, bvh, mesh, rng), lumina::vec3f32(1.0f));
+                        auto tile = film.tile(x0, y0, x0 + TILE_SIZE, y0 + TILE_SIZE);
+                        for(auto y = tile.y0(); y < tile.y1(); ++y) {
+                            for(auto x = tile.x0(); x < tile.x1(); ++x) {
+                                auto pixel_start = std::chrono::steady_clock::now();
+                                lumina::trace_counters counters{};
+
+                                for(lumina::u32 s = 0; s < samples; ++s) {
+                                    sampler.start_pixel_sample(x, y, s);
+                                    auto position = lumina::camera::sample_position(x, y, sampler);
+                                    auto ray = cam.generate_ray(position);
+
+                                    lumina::path_options options{.min_depth = MIN_DEPTH, .max_depth = MAX_DEPTH};
+                                    auto result = photon ? lumina::trace_ray(ray, bvh, mesh, photon_map, sampler, options) : heatmap ? lumina::trace_ray(ray, bvh, mesh, sampler, options, counters) : lumina::trace_ray(ray, bvh, mesh, sampler, options);
+                                    tile.add_sample(x, y, position, result.radiance, result.first_hit);
+                                    length += result.length;
+                                }
+
+                                if(heatmap) {
+                                    auto ns = std::chrono::duration<lumina::f64, std::nano>(std::chrono::steady_clock::now() - pixel_start).count();
+                                    heat_nodes[y * IMAGE_WIDTH + x] = lumina::f64(counters.nodes) / samples;
+                                    heat_triangles[y * IMAGE_WIDTH + x] = lumina::f64(counters.triangles) / samples;
+                                    heat_ns[y * IMAGE_WIDTH + x] = ns / samples;
+                                }
+                            }
                         }
-                        pixel /= lumina::f32(SAMPLES);
-                        pixels[y * IMAGE_WIDTH + x] = pixel;
+                        film.merge(tile);
                     }
                 },
                 seed()
@@ -186,7 +462,18 @@ int main(int argc, const char* argv[]) {
         t.join();
     }
 
-    save_ppm("test.ppm", pixels);
+    save_image(film.image());
+    if(aov) {
+        save_aovs(film);
+    }
+    if(denoise) {
+        save_denoised(film, samples);
+    }
+    if(heatmap) {
+        save_heatmap("test_heatmap_nodes.png", "traversal steps", heat_nodes);
+        save_heatmap("test_heatmap_triangles.png", "triangle tests", heat_triangles);
+        save_heatmap("test_heatmap_time.png", "nanoseconds", heat_ns);
+    }
 
     auto time_end = std::chrono::steady_clock::now();
 
@@ -194,5 +481,13 @@ int main(int argc, const char* argv[]) {
 
     std::clog << std::format("\nfinished. elapsed time: {} sec", elapsed) << std::endl;
 
+    auto total_samples = lumina::f64(total_pixels) * samples;
+    auto elapsed_ns = std::chrono::duration<lumina::f64, std::nano>(time_end - time_start).count();
+    std::clog << std::format("mean path length: {:.3f}, time per sample: {:.1f} ns ({:.1f} ns per thread)", lumina::f64(total_length) / total_samples, elapsed_ns / total_samples, elapsed_ns * thread_count / total_samples) << std::endl;
+
+    if constexpr(lumina::STATISTICS_ENABLED) {
+        lumina::report_statistics(thread_statistics);
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include <filesystem>
+#include <format>
+#include <iostream>
+
+#include "../lumina/lumina.hpp"
+
+// .obj -> lumina binary mesh (.lmesh)
+// usage: lumina_convert <obj path> [lmesh path]
+// output path defaults to the obj path with .lmesh extension
+// polygons are written in the leaf order of the spatial split bvh main.cpp builds, so rendering maps the file without reordering copies
+int main(int argc, const char* argv[]) {
+    if(argc < 2) {
+        std::clog << "usage: lumina_convert <obj path> [lmesh path]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path obj_path = argv[1];
+    std::filesystem::path binary_path = argc > 2 ? std::filesystem::path(argv[2]) : std::filesystem::path(obj_path).replace_extension(".lmesh");
+
+    lumina::convert_obj_to_binary(obj_path.string().c_str(), binary_path.string().c_str());
+
+    std::cout << std::format("{} ({} bytes) -> {} ({} bytes)", obj_path.string(), std::filesystem::file_size(obj_path), binary_path.string(), std::filesystem::file_size(binary_path)) << std::endl;
+
+    return 0;
+}
\ No newline at end of file